@@ -16,6 +16,7 @@
 #include "boards/otto-robot/otto_webserver.h"
 
 #include <cstring>
+#include <algorithm>
 #include <esp_log.h>
 #include <esp_netif.h>
 #include <cJSON.h>
@@ -291,7 +292,8 @@ void Application::ToggleChatState() {
         Schedule([this]() {
             if (!protocol_->IsAudioChannelOpened()) {
                 SetDeviceState(kDeviceStateConnecting);
-                if (!protocol_->OpenAudioChannel()) {
+                WaitForAudioChannelWarmUp();
+                if (!protocol_->IsAudioChannelOpened() && !protocol_->OpenAudioChannel()) {
                     return;
                 }
             }
@@ -328,7 +330,8 @@ void Application::StartListening() {
         Schedule([this]() {
             if (!protocol_->IsAudioChannelOpened()) {
                 SetDeviceState(kDeviceStateConnecting);
-                if (!protocol_->OpenAudioChannel()) {
+                WaitForAudioChannelWarmUp();
+                if (!protocol_->IsAudioChannelOpened() && !protocol_->OpenAudioChannel()) {
                     return;
                 }
             }
@@ -383,6 +386,24 @@ void Application::Start() {
     audio_service_.Initialize(codec);
     audio_service_.Start();
 
+    /* Power the codec for the audio the next state is about to use, so its first frame does not wait for it */
+    DeviceStateEventManager::GetInstance().RegisterStateChangeCallback([this](DeviceState previous_state, DeviceState current_state) {
+        switch (current_state) {
+            // The reply follows the listening session, warm the speaker up while the user talks
+            case kDeviceStateConnecting:
+            case kDeviceStateListening:
+            case kDeviceStateAudioTesting:
+                audio_service_.SetCodecPowerDemand(true, true);
+                break;
+            case kDeviceStateSpeaking:
+                audio_service_.SetCodecPowerDemand(listening_mode_ == kListeningModeRealtime, true);
+                break;
+            default:
+                audio_service_.SetCodecPowerDemand(false, false);
+                break;
+        }
+    });
+
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
@@ -393,6 +414,13 @@ void Application::Start() {
     callbacks.on_vad_change = [this](bool speaking) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_VAD_CHANGE);
     };
+#if CONFIG_AUDIO_CHANNEL_WARM_CONNECT
+    callbacks.on_audio_activity = [this]() {
+        Schedule([this]() {
+            WarmUpAudioChannel();
+        });
+    };
+#endif
     audio_service_.SetCallbacks(callbacks);
 
     // Start the main event loop task with priority 3
@@ -433,22 +461,38 @@ void Application::Start() {
         ESP_LOGW(TAG, "No protocol specified in the OTA config, using MQTT");
         protocol_ = std::make_unique<MqttProtocol>();
     }
+    // Realtime listening asks for short uplink frames, the server decides in its hello reply
+    protocol_->SetPreferredFrameDuration(aec_mode_ == kAecOff ? OPUS_FRAME_DURATION_MS : MIN_OPUS_FRAME_DURATION_MS);
 
     protocol_->OnConnected([this]() {
         DismissAlert();
     });
 
     protocol_->OnNetworkError([this](const std::string& message) {
+        if (warming_audio_channel_) {
+            ESP_LOGW(TAG, "Pre-connecting the audio channel failed: %s", message.c_str());
+            return;
+        }
         last_error_message_ = message;
         xEventGroupSetBits(event_group_, MAIN_EVENT_ERROR);
     });
+    protocol_->SetAudioPacketAllocator([this]() {
+        return audio_service_.AcquirePacket();
+    });
+    protocol_->SetAudioPacketRecycler([this](std::unique_ptr<AudioStreamPacket> packet) {
+        audio_service_.RecyclePacket(std::move(packet));
+    });
     protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
         if (device_state_ == kDeviceStateSpeaking) {
+            packet->origin_time_us = esp_timer_get_time();
             audio_service_.PushPacketToDecodeQueue(std::move(packet));
+        } else {
+            audio_service_.RecyclePacket(std::move(packet));
         }
     });
     protocol_->OnAudioChannelOpened([this, codec, &board]() {
         board.SetPowerSaveMode(false);
+        audio_service_.SetEncodeFrameDuration(protocol_->uplink_frame_duration());
         if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
@@ -463,467 +507,476 @@ void Application::Start() {
             SetDeviceState(kDeviceStateIdle);
         });
     });
-    protocol_->OnIncomingJson([this, display](const cJSON* root) {
-        // Parse JSON data
-        auto type = cJSON_GetObjectItem(root, "type");
-        if (strcmp(type->valuestring, "tts") == 0) {
-            auto state = cJSON_GetObjectItem(root, "state");
-            if (strcmp(state->valuestring, "start") == 0) {
-                Schedule([this]() {
-                    aborted_ = false;
-                    if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
-                        SetDeviceState(kDeviceStateSpeaking);
-                    }
-                });
-            } else if (strcmp(state->valuestring, "stop") == 0) {
-                Schedule([this]() {
-                    if (device_state_ == kDeviceStateSpeaking) {
-                        // Clear chat message when TTS stops
-                        auto display = Board::GetInstance().GetDisplay();
-                        display->SetChatMessage("", "");
-                        
-                        if (listening_mode_ == kListeningModeManualStop) {
-                            SetDeviceState(kDeviceStateIdle);
-                        } else {
-                            SetDeviceState(kDeviceStateListening);
-                        }
-                    }
-                });
-            } else if (strcmp(state->valuestring, "sentence_start") == 0) {
-                auto text = cJSON_GetObjectItem(root, "text");
-                if (cJSON_IsString(text)) {
-                    ESP_LOGI(TAG, "<< %s", text->valuestring);
-                    
-                    std::string assistant_msg = text->valuestring;
-                    
-                    // Display message immediately (Gemini check happens at TTS stop)
-                    Schedule([this, display, message = assistant_msg]() {
-                        display->SetChatMessage("assistant", message.c_str());
-                    });
-                }
-            }
-        } else if (strcmp(type->valuestring, "stt") == 0) {
+    RegisterJsonHandler("tts", [this, display](const cJSON* root) {
+        auto state = cJSON_GetObjectItem(root, "state");
+        if (!cJSON_IsString(state)) {
+            ESP_LOGW(TAG, "TTS state is invalid");
+            return;
+        }
+        // Most messages of a reply are sentences, so they are matched first
+        std::string_view state_name = state->valuestring;
+        if (state_name == "sentence_start") {
             auto text = cJSON_GetObjectItem(root, "text");
             if (cJSON_IsString(text)) {
-                std::string message = text->valuestring;
+                ESP_LOGI(TAG, "<< %s", text->valuestring);
                 
-                // Skip only truly empty messages
-                if (message.empty()) {
-                    ESP_LOGI(TAG, "Ignoring empty STT message from server");
-                    return;
-                }
+                std::string assistant_msg = text->valuestring;
                 
-                // Skip old-style placeholder wake words (for backward compatibility)
-                if (message == "web_ui" || message == "text_input" || message == "web_input" || message == "text input") {
-                    ESP_LOGI(TAG, "Ignoring legacy placeholder STT message from server: %s", message.c_str());
-                    return;
+                // Display message immediately (Gemini check happens at TTS stop)
+                Schedule([this, display, message = assistant_msg]() {
+                    display->SetChatMessage("assistant", message.c_str());
+                });
+            }
+        } else if (state_name == "start") {
+            Schedule([this]() {
+                aborted_ = false;
+                if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
+                    SetDeviceState(kDeviceStateSpeaking);
                 }
-                
-                // Skip echo of wake word from web UI (server echoes back the wake word we sent)
-                if (!last_web_wake_word_.empty() && message == last_web_wake_word_) {
-                    ESP_LOGI(TAG, "Skipping echo of web wake word from server: %s", message.c_str());
-                    last_web_wake_word_.clear();  // Clear after skipping once
-                    return;
+            });
+        } else if (state_name == "stop") {
+            Schedule([this]() {
+                if (device_state_ == kDeviceStateSpeaking) {
+                    // Clear chat message when TTS stops
+                    auto display = Board::GetInstance().GetDisplay();
+                    display->SetChatMessage("", "");
+                    
+                    if (listening_mode_ == kListeningModeManualStop) {
+                        SetDeviceState(kDeviceStateIdle);
+                    } else {
+                        SetDeviceState(kDeviceStateListening);
+                    }
                 }
+            });
+        }
+    });
+    RegisterJsonHandler("stt", [this, display](const cJSON* root) {
+        auto text = cJSON_GetObjectItem(root, "text");
+        if (cJSON_IsString(text)) {
+            std::string message = text->valuestring;
+            
+            // Skip only truly empty messages
+            if (message.empty()) {
+                ESP_LOGI(TAG, "Ignoring empty STT message from server");
+                return;
+            }
+            
+            // Skip old-style placeholder wake words (for backward compatibility)
+            if (message == "web_ui" || message == "text_input" || message == "web_input" || message == "text input") {
+                ESP_LOGI(TAG, "Ignoring legacy placeholder STT message from server: %s", message.c_str());
+                return;
+            }
+            
+            // Skip echo of wake word from web UI (server echoes back the wake word we sent)
+            if (!last_web_wake_word_.empty() && message == last_web_wake_word_) {
+                ESP_LOGI(TAG, "Skipping echo of web wake word from server: %s", message.c_str());
+                last_web_wake_word_.clear();  // Clear after skipping once
+                return;
+            }
+            
+            ESP_LOGI(TAG, ">> %s", message.c_str());
+            
+            // Voice command: special action sequence
+            // Phrase example (Vietnamese): "súng nè", "bắn", "bang bang", "bùm"
+            // Behavior: walk back 1 step (speed 15), sit down, then lie down slowly; show shocked emoji
+            // Also accept unaccented form: "sung ne", "ban", "bang bang", "bum"
+            std::string phrase = message;
+            auto to_lower = [](std::string s) {
+                for (auto &ch : s) ch = (char)tolower((unsigned char)ch);
+                return s;
+            };
+            auto contains = [](const std::string &hay, const char* needle) {
+                return hay.find(needle) != std::string::npos;
+            };
+            std::string lower = to_lower(phrase);
+            
+            ESP_LOGI(TAG, "🎤 STT voice command check: original='%s' lower='%s'", phrase.c_str(), lower.c_str());
+
+            bool shoot_seq =
+                // Shooting keywords (accented and unaccented)
+                contains(lower, "súng nè") ||
+                contains(lower, "sung ne") ||
+                contains(lower, "bắn") ||
+                contains(lower, "ban") ||
+                contains(lower, "bang bang") ||
+                contains(lower, "bùm") ||
+                contains(lower, "bum");
                 
-                ESP_LOGI(TAG, ">> %s", message.c_str());
-                
-                // Voice command: special action sequence
-                // Phrase example (Vietnamese): "súng nè", "bắn", "bang bang", "bùm"
-                // Behavior: walk back 1 step (speed 15), sit down, then lie down slowly; show shocked emoji
-                // Also accept unaccented form: "sung ne", "ban", "bang bang", "bum"
-                std::string phrase = message;
-                auto to_lower = [](std::string s) {
-                    for (auto &ch : s) ch = (char)tolower((unsigned char)ch);
-                    return s;
-                };
-                auto contains = [](const std::string &hay, const char* needle) {
-                    return hay.find(needle) != std::string::npos;
-                };
-                std::string lower = to_lower(phrase);
+            ESP_LOGI(TAG, "🎯 Shoot sequence match: %s", shoot_seq ? "YES ✅" : "NO ❌");
+            
+            // Check for instant action keywords
+            bool walk_forward = contains(lower, "đi tới") || contains(lower, "di toi") || 
+                               contains(lower, "tiến lên") || contains(lower, "tien len");
+            bool walk_back = contains(lower, "lùi lại") || contains(lower, "lui lai") || 
+                            contains(lower, "đi lùi") || contains(lower, "di lui");
+            bool turn_left = contains(lower, "quẹo trái") || contains(lower, "queo trai") || 
+                            contains(lower, "rẽ trái") || contains(lower, "re trai");
+            bool turn_right = contains(lower, "quẹo phải") || contains(lower, "queo phai") || 
+                             contains(lower, "rẽ phải") || contains(lower, "re phai");
+            bool sit_down = contains(lower, "ngồi xuống") || contains(lower, "ngoi xuong") || 
+                           contains(lower, "ngồi") || contains(lower, "ngoi");
+            bool dance = contains(lower, "nhảy") || contains(lower, "nhay") || 
+                        contains(lower, "múa") || contains(lower, "mua");
+            bool bow = contains(lower, "cúi chào") || contains(lower, "cui chao") || 
+                      contains(lower, "chào") || contains(lower, "chao");
+            bool show_ip = contains(lower, "192168") || contains(lower, "một chín hai") || 
+                          contains(lower, "mot chin hai") || contains(lower, "ip address");
+            bool open_panel = contains(lower, "mở bảng điều khiển") || contains(lower, "mo bang dieu khien") ||
+                             contains(lower, "bảng điều khiển") || contains(lower, "bang dieu khien") ||
+                             contains(lower, "mở trang điều khiển") || contains(lower, "mo trang dieu khien") ||
+                             contains(lower, "mở web") || contains(lower, "mo web");
+            bool show_qr = contains(lower, "mở qr") || contains(lower, "mo qr") || 
+                          contains(lower, "mở mã qr") || contains(lower, "mo ma qr") ||
+                          contains(lower, "hiển thị qr") || contains(lower, "hien thi qr") ||
+                          contains(lower, "mở mạng qr") || contains(lower, "mo mang qr");
+
+            // New voice pose triggers
+            bool toilet_pose = contains(lower, "đi vệ sinh") || contains(lower, "di ve sinh") ||
+                               contains(lower, "đi toilet") || contains(lower, "di toilet");
+            bool pushup_pose = contains(lower, "chống đẩy") || contains(lower, "chong day") ||
+                               contains(lower, "tập thể dục") || contains(lower, "tap the duc") ||
+                               contains(lower, "hít đất") || contains(lower, "hit dat");
+            
+            if (shoot_seq) {
+                ESP_LOGI(TAG, "🔫 EXECUTING shoot/defend sequence NOW! (No text display, only emoji)");
+                // Lock emotion IMMEDIATELY before Schedule
+                emotion_locked_ = true;
+                ESP_LOGI(TAG, "🔒 Emotion LOCKED for keyword sequence");
                 
-                ESP_LOGI(TAG, "🎤 STT voice command check: original='%s' lower='%s'", phrase.c_str(), lower.c_str());
-
-                bool shoot_seq =
-                    // Shooting keywords (accented and unaccented)
-                    contains(lower, "súng nè") ||
-                    contains(lower, "sung ne") ||
-                    contains(lower, "bắn") ||
-                    contains(lower, "ban") ||
-                    contains(lower, "bang bang") ||
-                    contains(lower, "bùm") ||
-                    contains(lower, "bum");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    // Set shocked emotion/icon immediately (NO text message)
+                    disp->SetEmotion("shocked");
+
+                    // Queue movement sequence
+                    // 1) Walk back 1 step, speed delay 15 (smaller = faster per implementation)
+                    otto_controller_queue_action(ACTION_DOG_WALK_BACK, 1, 15, 0, 0);
+                    // 2) Sit down (3 seconds for complete motion)
+                    otto_controller_queue_action(ACTION_DOG_SIT_DOWN, 1, 3000, 0, 0);
+                    // 3) Lie down slowly
+                    otto_controller_queue_action(ACTION_DOG_LIE_DOWN, 1, 1500, 0, 0);
+                    // 4) After sequence, wait 3s then return home
+                    otto_controller_queue_action(ACTION_DELAY, 0, 3000, 0, 0);
+                    otto_controller_queue_action(ACTION_HOME, 1, 500, 0, 0);
                     
-                ESP_LOGI(TAG, "🎯 Shoot sequence match: %s", shoot_seq ? "YES ✅" : "NO ❌");
-                
-                // Check for instant action keywords
-                bool walk_forward = contains(lower, "đi tới") || contains(lower, "di toi") || 
-                                   contains(lower, "tiến lên") || contains(lower, "tien len");
-                bool walk_back = contains(lower, "lùi lại") || contains(lower, "lui lai") || 
-                                contains(lower, "đi lùi") || contains(lower, "di lui");
-                bool turn_left = contains(lower, "quẹo trái") || contains(lower, "queo trai") || 
-                                contains(lower, "rẽ trái") || contains(lower, "re trai");
-                bool turn_right = contains(lower, "quẹo phải") || contains(lower, "queo phai") || 
-                                 contains(lower, "rẽ phải") || contains(lower, "re phai");
-                bool sit_down = contains(lower, "ngồi xuống") || contains(lower, "ngoi xuong") || 
-                               contains(lower, "ngồi") || contains(lower, "ngoi");
-                bool dance = contains(lower, "nhảy") || contains(lower, "nhay") || 
-                            contains(lower, "múa") || contains(lower, "mua");
-                bool bow = contains(lower, "cúi chào") || contains(lower, "cui chao") || 
-                          contains(lower, "chào") || contains(lower, "chao");
-                bool show_ip = contains(lower, "192168") || contains(lower, "một chín hai") || 
-                              contains(lower, "mot chin hai") || contains(lower, "ip address");
-                bool open_panel = contains(lower, "mở bảng điều khiển") || contains(lower, "mo bang dieu khien") ||
-                                 contains(lower, "bảng điều khiển") || contains(lower, "bang dieu khien") ||
-                                 contains(lower, "mở trang điều khiển") || contains(lower, "mo trang dieu khien") ||
-                                 contains(lower, "mở web") || contains(lower, "mo web");
-                bool show_qr = contains(lower, "mở qr") || contains(lower, "mo qr") || 
-                              contains(lower, "mở mã qr") || contains(lower, "mo ma qr") ||
-                              contains(lower, "hiển thị qr") || contains(lower, "hien thi qr") ||
-                              contains(lower, "mở mạng qr") || contains(lower, "mo mang qr");
-
-                // New voice pose triggers
-                bool toilet_pose = contains(lower, "đi vệ sinh") || contains(lower, "di ve sinh") ||
-                                   contains(lower, "đi toilet") || contains(lower, "di toilet");
-                bool pushup_pose = contains(lower, "chống đẩy") || contains(lower, "chong day") ||
-                                   contains(lower, "tập thể dục") || contains(lower, "tap the duc") ||
-                                   contains(lower, "hít đất") || contains(lower, "hit dat");
-                
-                if (shoot_seq) {
-                    ESP_LOGI(TAG, "🔫 EXECUTING shoot/defend sequence NOW! (No text display, only emoji)");
-                    // Lock emotion IMMEDIATELY before Schedule
-                    emotion_locked_ = true;
-                    ESP_LOGI(TAG, "🔒 Emotion LOCKED for keyword sequence");
+                    // Unlock emotion after sequence completes (total ~8s)
+                    // Schedule unlock after action queue finishes
+                    xTaskCreate([](void* arg) {
+                        vTaskDelay(pdMS_TO_TICKS(9000)); // Wait for sequence to complete
+                        Application* app = static_cast<Application*>(arg);
+                        app->Schedule([app]() {
+                            app->emotion_locked_ = false;
+                            ESP_LOGI("Application", "🔓 Emotion UNLOCKED after keyword sequence");
+                        });
+                        vTaskDelete(NULL);
+                    }, "emotion_unlock", 2048, this, 1, NULL);
+                });
+                ESP_LOGI(TAG, "✅ Shoot/defend sequence scheduled, returning now (no chat message)");
+                return; // handled - skip SetChatMessage
+            }
+            
+            if (show_qr) {
+                ESP_LOGI(TAG, "📱 QR keyword detected: showing winking emoji for 30s (no movement, no IP, no activation code)");
+                // Lock emotion immediately so other actions cannot override during display period
+                emotion_locked_ = true;
+                Schedule([this]() {
+                    if (auto disp = Board::GetInstance().GetDisplay()) {
+                        // Show only winking emoji, no chat/status text
+                        disp->SetEmotion("winking");
+                    }
+                    // Unlock after 30 seconds
+                    xTaskCreate([](void* arg) {
+                        vTaskDelay(pdMS_TO_TICKS(30000)); // 30s display duration
+                        Application* app = static_cast<Application*>(arg);
+                        app->Schedule([app]() {
+                            app->emotion_locked_ = false;
+                            ESP_LOGI("Application", "🔓 Emotion UNLOCKED after QR winking display");
+                        });
+                        vTaskDelete(NULL);
+                    }, "qr_wink_unlock", 2048, this, 1, NULL);
+                });
+                return; // handled
+            }
+
+            if (pushup_pose) {
+                ESP_LOGI(TAG, "💪 Voice trigger: pushup exercise");
+                Schedule([this]() {
+                    if (auto disp = Board::GetInstance().GetDisplay()) disp->SetEmotion("happy");
+                    // Default 3 pushups speed 150
+                    otto_controller_queue_action(ACTION_DOG_PUSHUP, 3, 150, 0, 0);
+                });
+                return; // handled
+            }
+
+            if (toilet_pose) {
+                ESP_LOGI(TAG, "🚽 Voice trigger: toilet squat pose");
+                Schedule([this]() {
+                    if (auto disp = Board::GetInstance().GetDisplay()) disp->SetEmotion("embarrassed");
+                    // Hold 3000 ms, speed base 150
+                    otto_controller_queue_action(ACTION_DOG_TOILET, 3000, 150, 0, 0);
+                });
+                return; // handled
+            }
+            
+            // Instant action commands - execute immediately without LLM
+            if (walk_forward) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Walk Forward");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("happy");
+                    otto_controller_queue_action(ACTION_DOG_WALK, 3, 150, 0, 0);
+                });
+                return;
+            }
+            if (walk_back) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Walk Back");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("neutral");
+                    otto_controller_queue_action(ACTION_DOG_WALK_BACK, 3, 150, 0, 0);
+                });
+                return;
+            }
+            if (turn_left) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Turn Left");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("happy");
+                    otto_controller_queue_action(ACTION_DOG_TURN_LEFT, 3, 150, 0, 0);
+                });
+                return;
+            }
+            if (turn_right) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Turn Right");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("happy");
+                    otto_controller_queue_action(ACTION_DOG_TURN_RIGHT, 3, 150, 0, 0);
+                });
+                return;
+            }
+            if (sit_down) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Sit Down");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("sleepy");
+                    otto_controller_queue_action(ACTION_DOG_SIT_DOWN, 1, 1000, 0, 0);
+                });
+                return;
+            }
+            if (dance) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Dance 4 Feet");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("happy");
+                    otto_controller_queue_action(ACTION_DOG_DANCE_4_FEET, 3, 200, 0, 0);
+                });
+                return;
+            }
+            if (bow) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Bow");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("happy");
+                    otto_controller_queue_action(ACTION_DOG_BOW, 1, 1500, 0, 0);
+                });
+                return;
+            }
+            if (show_ip) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Show WiFi IP Address for 30s");
+                Schedule([this]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    disp->SetEmotion("happy");
                     
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        // Set shocked emotion/icon immediately (NO text message)
-                        disp->SetEmotion("shocked");
-
-                        // Queue movement sequence
-                        // 1) Walk back 1 step, speed delay 15 (smaller = faster per implementation)
-                        otto_controller_queue_action(ACTION_DOG_WALK_BACK, 1, 15, 0, 0);
-                        // 2) Sit down (3 seconds for complete motion)
-                        otto_controller_queue_action(ACTION_DOG_SIT_DOWN, 1, 3000, 0, 0);
-                        // 3) Lie down slowly
-                        otto_controller_queue_action(ACTION_DOG_LIE_DOWN, 1, 1500, 0, 0);
-                        // 4) After sequence, wait 3s then return home
-                        otto_controller_queue_action(ACTION_DELAY, 0, 3000, 0, 0);
-                        otto_controller_queue_action(ACTION_HOME, 1, 500, 0, 0);
-                        
-                        // Unlock emotion after sequence completes (total ~8s)
-                        // Schedule unlock after action queue finishes
+                    // Get IP address and display it
+                    esp_netif_ip_info_t ip_info;
+                    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+                    if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
+                        char ip_str[64];
+                        snprintf(ip_str, sizeof(ip_str), "📱 IP: %d.%d.%d.%d", 
+                                 IP2STR(&ip_info.ip));
+                        ESP_LOGI("Application", "\033[1;33m🌟 Station IP: " IPSTR "\033[0m", 
+                                 IP2STR(&ip_info.ip));
+                        disp->SetChatMessage("system", ip_str);
+                        // Keep display for 30 seconds
                         xTaskCreate([](void* arg) {
-                            vTaskDelay(pdMS_TO_TICKS(9000)); // Wait for sequence to complete
-                            Application* app = static_cast<Application*>(arg);
-                            app->Schedule([app]() {
-                                app->emotion_locked_ = false;
-                                ESP_LOGI("Application", "🔓 Emotion UNLOCKED after keyword sequence");
-                            });
-                            vTaskDelete(NULL);
-                        }, "emotion_unlock", 2048, this, 1, NULL);
-                    });
-                    ESP_LOGI(TAG, "✅ Shoot/defend sequence scheduled, returning now (no chat message)");
-                    return; // handled - skip SetChatMessage
-                }
-                
-                if (show_qr) {
-                    ESP_LOGI(TAG, "📱 QR keyword detected: showing winking emoji for 30s (no movement, no IP, no activation code)");
-                    // Lock emotion immediately so other actions cannot override during display period
-                    emotion_locked_ = true;
-                    Schedule([this]() {
-                        if (auto disp = Board::GetInstance().GetDisplay()) {
-                            // Show only winking emoji, no chat/status text
-                            disp->SetEmotion("winking");
-                        }
-                        // Unlock after 30 seconds
-                        xTaskCreate([](void* arg) {
-                            vTaskDelay(pdMS_TO_TICKS(30000)); // 30s display duration
-                            Application* app = static_cast<Application*>(arg);
-                            app->Schedule([app]() {
-                                app->emotion_locked_ = false;
-                                ESP_LOGI("Application", "🔓 Emotion UNLOCKED after QR winking display");
-                            });
+                            vTaskDelay(pdMS_TO_TICKS(30000));
+                            auto d = Board::GetInstance().GetDisplay();
+                            if (d) {
+                                d->SetEmotion("neutral");
+                                d->SetChatMessage("", "");
+                            }
+                            ESP_LOGI("Application", "🔓 IP display cleared after 30s");
                             vTaskDelete(NULL);
-                        }, "qr_wink_unlock", 2048, this, 1, NULL);
-                    });
-                    return; // handled
-                }
-
-                if (pushup_pose) {
-                    ESP_LOGI(TAG, "💪 Voice trigger: pushup exercise");
-                    Schedule([this]() {
-                        if (auto disp = Board::GetInstance().GetDisplay()) disp->SetEmotion("happy");
-                        // Default 3 pushups speed 150
-                        otto_controller_queue_action(ACTION_DOG_PUSHUP, 3, 150, 0, 0);
-                    });
-                    return; // handled
-                }
-
-                if (toilet_pose) {
-                    ESP_LOGI(TAG, "🚽 Voice trigger: toilet squat pose");
-                    Schedule([this]() {
-                        if (auto disp = Board::GetInstance().GetDisplay()) disp->SetEmotion("embarrassed");
-                        // Hold 3000 ms, speed base 150
-                        otto_controller_queue_action(ACTION_DOG_TOILET, 3000, 150, 0, 0);
-                    });
-                    return; // handled
-                }
-                
-                // Instant action commands - execute immediately without LLM
-                if (walk_forward) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Walk Forward");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("happy");
-                        otto_controller_queue_action(ACTION_DOG_WALK, 3, 150, 0, 0);
-                    });
-                    return;
-                }
-                if (walk_back) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Walk Back");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("neutral");
-                        otto_controller_queue_action(ACTION_DOG_WALK_BACK, 3, 150, 0, 0);
-                    });
-                    return;
-                }
-                if (turn_left) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Turn Left");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("happy");
-                        otto_controller_queue_action(ACTION_DOG_TURN_LEFT, 3, 150, 0, 0);
-                    });
-                    return;
-                }
-                if (turn_right) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Turn Right");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("happy");
-                        otto_controller_queue_action(ACTION_DOG_TURN_RIGHT, 3, 150, 0, 0);
-                    });
-                    return;
-                }
-                if (sit_down) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Sit Down");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("sleepy");
-                        otto_controller_queue_action(ACTION_DOG_SIT_DOWN, 1, 1000, 0, 0);
-                    });
-                    return;
-                }
-                if (dance) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Dance 4 Feet");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("happy");
-                        otto_controller_queue_action(ACTION_DOG_DANCE_4_FEET, 3, 200, 0, 0);
-                    });
-                    return;
-                }
-                if (bow) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Bow");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        disp->SetEmotion("happy");
-                        otto_controller_queue_action(ACTION_DOG_BOW, 1, 1500, 0, 0);
-                    });
-                    return;
-                }
-                if (show_ip) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Show WiFi IP Address for 30s");
-                    Schedule([this]() {
-                        auto disp = Board::GetInstance().GetDisplay();
+                        }, "ip_clear", 2048, nullptr, 1, NULL);
+                    } else {
+                        ESP_LOGE("Application", "❌ Failed to get IP info");
+                        disp->SetChatMessage("system", "WiFi chưa kết nối!");
+                    }
+                });
+                return;
+            }
+            if (open_panel) {
+                ESP_LOGI(TAG, "⚡ INSTANT ACTION: Open Control Panel (Start Webserver + Show IP)");
+                Schedule([this]() {
+                    // Check if webserver is already running
+                    extern bool webserver_enabled;
+                    auto disp = Board::GetInstance().GetDisplay();
+                    
+                    if (!webserver_enabled) {
+                        ESP_LOGI(TAG, "🌐 Starting webserver for control panel access");
+                        otto_start_webserver();
+                    } else {
+                        ESP_LOGI(TAG, "🌐 Webserver already running");
+                    }
+                    
+                    // Display IP address with happy emoji for 15 seconds
+                    if (disp) {
                         disp->SetEmotion("happy");
                         
-                        // Get IP address and display it
+                        // Get and display IP address
                         esp_netif_ip_info_t ip_info;
                         esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
                         if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
                             char ip_str[64];
                             snprintf(ip_str, sizeof(ip_str), "📱 IP: %d.%d.%d.%d", 
                                      IP2STR(&ip_info.ip));
-                            ESP_LOGI("Application", "\033[1;33m🌟 Station IP: " IPSTR "\033[0m", 
-                                     IP2STR(&ip_info.ip));
+                            ESP_LOGI("Application", "🌟 Station IP: " IPSTR, IP2STR(&ip_info.ip));
                             disp->SetChatMessage("system", ip_str);
-                            // Keep display for 30 seconds
+                            
+                            // Keep display for 15 seconds
                             xTaskCreate([](void* arg) {
-                                vTaskDelay(pdMS_TO_TICKS(30000));
+                                vTaskDelay(pdMS_TO_TICKS(15000));
                                 auto d = Board::GetInstance().GetDisplay();
                                 if (d) {
                                     d->SetEmotion("neutral");
                                     d->SetChatMessage("", "");
                                 }
-                                ESP_LOGI("Application", "🔓 IP display cleared after 30s");
+                                ESP_LOGI("Application", "🔓 IP display cleared after 15s");
                                 vTaskDelete(NULL);
-                            }, "ip_clear", 2048, nullptr, 1, NULL);
+                            }, "panel_ip_clear", 2048, nullptr, 1, NULL);
                         } else {
                             ESP_LOGE("Application", "❌ Failed to get IP info");
-                            disp->SetChatMessage("system", "WiFi chưa kết nối!");
-                        }
-                    });
-                    return;
-                }
-                if (open_panel) {
-                    ESP_LOGI(TAG, "⚡ INSTANT ACTION: Open Control Panel (Start Webserver + Show IP)");
-                    Schedule([this]() {
-                        // Check if webserver is already running
-                        extern bool webserver_enabled;
-                        auto disp = Board::GetInstance().GetDisplay();
-                        
-                        if (!webserver_enabled) {
-                            ESP_LOGI(TAG, "🌐 Starting webserver for control panel access");
-                            otto_start_webserver();
-                        } else {
-                            ESP_LOGI(TAG, "🌐 Webserver already running");
+                            disp->SetChatMessage("system", "✅ Web server đã khởi động!");
                         }
-                        
-                        // Display IP address with happy emoji for 15 seconds
-                        if (disp) {
-                            disp->SetEmotion("happy");
-                            
-                            // Get and display IP address
-                            esp_netif_ip_info_t ip_info;
-                            esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-                            if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
-                                char ip_str[64];
-                                snprintf(ip_str, sizeof(ip_str), "📱 IP: %d.%d.%d.%d", 
-                                         IP2STR(&ip_info.ip));
-                                ESP_LOGI("Application", "🌟 Station IP: " IPSTR, IP2STR(&ip_info.ip));
-                                disp->SetChatMessage("system", ip_str);
-                                
-                                // Keep display for 15 seconds
-                                xTaskCreate([](void* arg) {
-                                    vTaskDelay(pdMS_TO_TICKS(15000));
-                                    auto d = Board::GetInstance().GetDisplay();
-                                    if (d) {
-                                        d->SetEmotion("neutral");
-                                        d->SetChatMessage("", "");
-                                    }
-                                    ESP_LOGI("Application", "🔓 IP display cleared after 15s");
-                                    vTaskDelete(NULL);
-                                }, "panel_ip_clear", 2048, nullptr, 1, NULL);
-                            } else {
-                                ESP_LOGE("Application", "❌ Failed to get IP info");
-                                disp->SetChatMessage("system", "✅ Web server đã khởi động!");
-                            }
-                        }
-                    });
-                    return;
-                }
-                
-                // Show user's recognized speech (only if NOT a keyword trigger)
-                Schedule([this, display, message = std::string(text->valuestring)]() {
-                    display->SetChatMessage("user", message.c_str());
+                    }
                 });
+                return;
+            }
+            
+            // Show user's recognized speech (only if NOT a keyword trigger)
+            Schedule([this, display, message = std::string(text->valuestring)]() {
+                display->SetChatMessage("user", message.c_str());
+            });
 
-                // Voice commands: Toggle between Otto GIF emoji mode and default text emoji mode
-                // Keywords (Vietnamese):
-                //   - "emoji chính"  => switch to Otto GIF mode (primary/animated)
-                //   - "emoji mặc định" => switch to default text mode
-                // Also accept unaccented forms: "emoji chinh", "emoji mac dinh"
-                // Note: helpers defined above
+            // Voice commands: Toggle between Otto GIF emoji mode and default text emoji mode
+            // Keywords (Vietnamese):
+            //   - "emoji chính"  => switch to Otto GIF mode (primary/animated)
+            //   - "emoji mặc định" => switch to default text mode
+            // Also accept unaccented forms: "emoji chinh", "emoji mac dinh"
+            // Note: helpers defined above
 
-                bool ask_otto = false;
-                bool ask_default = false;
+            bool ask_otto = false;
+            bool ask_default = false;
 
-                // Exact keywords only
-                if (contains(lower, "emoji chính") || contains(lower, "emoji chinh")) {
-                    ask_otto = true;
-                }
-                if (contains(lower, "emoji mặc định") || contains(lower, "emoji mac dinh")) {
-                    ask_default = true;
-                }
+            // Exact keywords only
+            if (contains(lower, "emoji chính") || contains(lower, "emoji chinh")) {
+                ask_otto = true;
+            }
+            if (contains(lower, "emoji mặc định") || contains(lower, "emoji mac dinh")) {
+                ask_default = true;
+            }
 
-                if (ask_otto || ask_default) {
-                    Schedule([this, ask_otto, ask_default]() {
-                        auto disp = Board::GetInstance().GetDisplay();
-                        // Try OttoEmojiDisplay specific API when available
-                        if (auto otto = dynamic_cast<OttoEmojiDisplay*>(disp)) {
-                            if (ask_otto && !ask_default) {
-                                ESP_LOGI(TAG, "🎙 Voice cmd: switch to Otto GIF emoji mode");
-                                otto->SetEmojiMode(true);
-                                otto->SetEmotion("neutral");
-                                otto->ShowNotification("Chế độ emoji: Otto GIF", 2000);
-                            } else if (ask_default && !ask_otto) {
-                                ESP_LOGI(TAG, "🎙 Voice cmd: switch to Default text emoji mode");
-                                otto->SetEmojiMode(false);
-                                otto->SetEmotion("neutral");
-                                otto->ShowNotification("Chế độ emoji: Mặc định", 2000);
-                            } else {
-                                // If both detected, prefer explicit default unless phrase clearly says otto
-                                ESP_LOGI(TAG, "🎙 Voice cmd ambiguous; defaulting to text mode");
-                                otto->SetEmojiMode(false);
-                                otto->SetEmotion("neutral");
-                                otto->ShowNotification("Chế độ emoji: Mặc định", 2000);
-                            }
+            if (ask_otto || ask_default) {
+                Schedule([this, ask_otto, ask_default]() {
+                    auto disp = Board::GetInstance().GetDisplay();
+                    // Try OttoEmojiDisplay specific API when available
+                    if (auto otto = dynamic_cast<OttoEmojiDisplay*>(disp)) {
+                        if (ask_otto && !ask_default) {
+                            ESP_LOGI(TAG, "🎙 Voice cmd: switch to Otto GIF emoji mode");
+                            otto->SetEmojiMode(true);
+                            otto->SetEmotion("neutral");
+                            otto->ShowNotification("Chế độ emoji: Otto GIF", 2000);
+                        } else if (ask_default && !ask_otto) {
+                            ESP_LOGI(TAG, "🎙 Voice cmd: switch to Default text emoji mode");
+                            otto->SetEmojiMode(false);
+                            otto->SetEmotion("neutral");
+                            otto->ShowNotification("Chế độ emoji: Mặc định", 2000);
                         } else {
-                            // Fallback: use base display only (no Otto-specific toggling)
-                            ESP_LOGW(TAG, "Voice emoji mode toggle requested but Otto display not available");
-                            disp->ShowNotification("Không hỗ trợ đổi emoji trên màn hình hiện tại", 2500);
+                            // If both detected, prefer explicit default unless phrase clearly says otto
+                            ESP_LOGI(TAG, "🎙 Voice cmd ambiguous; defaulting to text mode");
+                            otto->SetEmojiMode(false);
+                            otto->SetEmotion("neutral");
+                            otto->ShowNotification("Chế độ emoji: Mặc định", 2000);
                         }
-                    });
-                }
-            }
-        } else if (strcmp(type->valuestring, "llm") == 0) {
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(emotion)) {
-                Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
-                    // Skip emotion change if locked (keyword sequence in progress)
-                    if (emotion_locked_) {
-                        ESP_LOGW(TAG, "⛔ Ignoring LLM emotion '%s' (emotion locked for keyword)", emotion_str.c_str());
-                        return;
+                    } else {
+                        // Fallback: use base display only (no Otto-specific toggling)
+                        ESP_LOGW(TAG, "Voice emoji mode toggle requested but Otto display not available");
+                        disp->ShowNotification("Không hỗ trợ đổi emoji trên màn hình hiện tại", 2500);
                     }
-                    display->SetEmotion(emotion_str.c_str());
                 });
             }
-        } else if (strcmp(type->valuestring, "mcp") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            if (cJSON_IsObject(payload)) {
-                McpServer::GetInstance().ParseMessage(payload);
-            }
-        } else if (strcmp(type->valuestring, "system") == 0) {
-            auto command = cJSON_GetObjectItem(root, "command");
-            if (cJSON_IsString(command)) {
-                ESP_LOGI(TAG, "System command: %s", command->valuestring);
-                if (strcmp(command->valuestring, "reboot") == 0) {
-                    // Do a reboot if user requests a OTA update
-                    Schedule([this]() {
-                        Reboot();
-                    });
-                } else {
-                    ESP_LOGW(TAG, "Unknown system command: %s", command->valuestring);
+        }
+    });
+    RegisterJsonHandler("llm", [this, display](const cJSON* root) {
+        auto emotion = cJSON_GetObjectItem(root, "emotion");
+        if (cJSON_IsString(emotion)) {
+            Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
+                // Skip emotion change if locked (keyword sequence in progress)
+                if (emotion_locked_) {
+                    ESP_LOGW(TAG, "⛔ Ignoring LLM emotion '%s' (emotion locked for keyword)", emotion_str.c_str());
+                    return;
                 }
-            }
-        } else if (strcmp(type->valuestring, "alert") == 0) {
-            auto status = cJSON_GetObjectItem(root, "status");
-            auto message = cJSON_GetObjectItem(root, "message");
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(status) && cJSON_IsString(message) && cJSON_IsString(emotion)) {
-                Alert(status->valuestring, message->valuestring, emotion->valuestring, Lang::Sounds::OGG_VIBRATION);
-            } else {
-                ESP_LOGW(TAG, "Alert command requires status, message and emotion");
-            }
-#if CONFIG_RECEIVE_CUSTOM_MESSAGE
-        } else if (strcmp(type->valuestring, "custom") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            ESP_LOGI(TAG, "Received custom message: %s", cJSON_PrintUnformatted(root));
-            if (cJSON_IsObject(payload)) {
-                Schedule([this, display, payload_str = std::string(cJSON_PrintUnformatted(payload))]() {
-                    display->SetChatMessage("system", payload_str.c_str());
+                display->SetEmotion(emotion_str.c_str());
+            });
+        }
+    });
+    RegisterJsonHandler("mcp", [](const cJSON* root) {
+        auto payload = cJSON_GetObjectItem(root, "payload");
+        if (cJSON_IsObject(payload)) {
+            McpServer::GetInstance().ParseMessage(payload);
+        }
+    });
+    RegisterJsonHandler("system", [this](const cJSON* root) {
+        auto command = cJSON_GetObjectItem(root, "command");
+        if (cJSON_IsString(command)) {
+            ESP_LOGI(TAG, "System command: %s", command->valuestring);
+            if (strcmp(command->valuestring, "reboot") == 0) {
+                // Do a reboot if user requests a OTA update
+                Schedule([this]() {
+                    Reboot();
                 });
             } else {
-                ESP_LOGW(TAG, "Invalid custom message format: missing payload");
+                ESP_LOGW(TAG, "Unknown system command: %s", command->valuestring);
             }
-#endif
+        }
+    });
+    RegisterJsonHandler("alert", [this](const cJSON* root) {
+        auto status = cJSON_GetObjectItem(root, "status");
+        auto message = cJSON_GetObjectItem(root, "message");
+        auto emotion = cJSON_GetObjectItem(root, "emotion");
+        if (cJSON_IsString(status) && cJSON_IsString(message) && cJSON_IsString(emotion)) {
+            Alert(status->valuestring, message->valuestring, emotion->valuestring, Lang::Sounds::OGG_VIBRATION);
         } else {
-            ESP_LOGW(TAG, "Unknown message type: %s", type->valuestring);
+            ESP_LOGW(TAG, "Alert command requires status, message and emotion");
         }
     });
+#if CONFIG_RECEIVE_CUSTOM_MESSAGE
+    RegisterJsonHandler("custom", [this, display](const cJSON* root) {
+        auto payload = cJSON_GetObjectItem(root, "payload");
+        ESP_LOGI(TAG, "Received custom message: %s", cJSON_PrintUnformatted(root));
+        if (cJSON_IsObject(payload)) {
+            Schedule([this, display, payload_str = std::string(cJSON_PrintUnformatted(payload))]() {
+                display->SetChatMessage("system", payload_str.c_str());
+            });
+        } else {
+            ESP_LOGW(TAG, "Invalid custom message format: missing payload");
+        }
+    });
+#endif
+    protocol_->OnIncomingJson([this](const cJSON* root) {
+        HandleIncomingJson(root);
+    });
     bool protocol_started = protocol_->Start();
 
     SystemInfo::PrintHeapStats();
@@ -966,11 +1019,7 @@ void Application::MainEventLoop() {
         }
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
-            while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
-                    break;
-                }
-            }
+            SendQueuedAudio();
         }
 
         if (bits & MAIN_EVENT_WAKE_WORD_DETECTED) {
@@ -997,17 +1046,186 @@ void Application::MainEventLoop() {
             clock_ticks_++;
             auto display = Board::GetInstance().GetDisplay();
             display->UpdateStatusBar();
+
+            // Loss over the last second steers the uplink encoder, a closed channel reports a clean link
+            AudioLinkQuality link;
+            bool has_link = protocol_ && protocol_->IsAudioChannelOpened() && protocol_->GetAudioLinkQuality(link);
+            audio_service_.SetLinkQuality(has_link ? link : AudioLinkQuality());
+
+#if CONFIG_AUDIO_CHANNEL_WARM_CONNECT
+            if (warm_channel_open_time_ != 0 &&
+                esp_timer_get_time() - warm_channel_open_time_ > CONFIG_AUDIO_CHANNEL_WARM_TIMEOUT * 1000000LL) {
+                warm_channel_open_time_ = 0;
+                if (device_state_ == kDeviceStateIdle && protocol_ && protocol_->IsAudioChannelOpened()) {
+                    ESP_LOGI(TAG, "Closing the unused pre-connected audio channel");
+                    protocol_->CloseAudioChannel();
+                }
+            }
+#endif
         
             // Print the debug info every 10 seconds
             if (clock_ticks_ % 10 == 0) {
                 // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
                 // SystemInfo::PrintTaskList();
                 SystemInfo::PrintHeapStats();
+#if CONFIG_AUDIO_DEBUG_STATISTICS
+                auto stats = audio_service_.GetDebugStatistics();
+                ESP_LOGI(TAG, "audio input: %lu encode: %lu decode: %lu playback: %lu pool allocs: %lu heap allocs: %lu",
+                    (unsigned long)stats.input_count, (unsigned long)stats.encode_count, (unsigned long)stats.decode_count,
+                    (unsigned long)stats.playback_count, (unsigned long)stats.pool_alloc_count,
+                    (unsigned long)stats.heap_alloc_count);
+                ESP_LOGI(TAG, "jitter: %lu ms depth: %lu late: %lu lost: %lu concealed: %lu",
+                    (unsigned long)stats.jitter_ms, (unsigned long)stats.jitter_depth, (unsigned long)stats.late_packet_count,
+                    (unsigned long)stats.lost_packet_count, (unsigned long)stats.concealed_frame_count);
+                auto encode_avg = stats.encode_count ? stats.encode_time_total_us / stats.encode_count : 0;
+                auto decode_avg = stats.decode_count ? stats.decode_time_total_us / stats.decode_count : 0;
+                ESP_LOGI(TAG, "opus encode avg: %lu us max: %lu us, decode avg: %lu us max: %lu us",
+                    (unsigned long)encode_avg, (unsigned long)stats.encode_time_max_us,
+                    (unsigned long)decode_avg, (unsigned long)stats.decode_time_max_us);
+                if (stats.uplink_suppressed_frames > 0) {
+                    ESP_LOGI(TAG, "uplink sent: %lu bytes, suppressed: %lu frames %lu bytes",
+                        (unsigned long)stats.uplink_sent_bytes, (unsigned long)stats.uplink_suppressed_frames,
+                        (unsigned long)stats.uplink_suppressed_bytes);
+                }
+                if (stats.processor_ring_high_water > 0) {
+                    ESP_LOGI(TAG, "audio processor latency: %lu ms max: %lu ms, ring: %lu samples max: %lu",
+                        (unsigned long)stats.processor_latency_ms, (unsigned long)stats.processor_latency_max_ms,
+                        (unsigned long)stats.processor_ring_samples, (unsigned long)stats.processor_ring_high_water);
+                }
+                if (stats.codec_cold_starts + stats.codec_warm_starts > 0) {
+                    ESP_LOGI(TAG, "codec power: cold starts: %lu warm starts: %lu, power on max: input %lu us output %lu us, on: input %lu ms output %lu ms, off: %lu ms",
+                        (unsigned long)stats.codec_cold_starts, (unsigned long)stats.codec_warm_starts,
+                        (unsigned long)stats.codec_input_power_on_max_us, (unsigned long)stats.codec_output_power_on_max_us,
+                        (unsigned long)stats.codec_input_on_ms, (unsigned long)stats.codec_output_on_ms,
+                        (unsigned long)stats.codec_off_ms);
+                }
+                if (has_link) {
+                    ESP_LOGI(TAG, "link: received %lu expected %lu lost %lu reordered %lu duplicates %lu jitter %lu ms loss %lu%%",
+                        (unsigned long)link.received, (unsigned long)link.expected, (unsigned long)link.lost,
+                        (unsigned long)link.reordered, (unsigned long)link.duplicates, (unsigned long)link.jitter_ms,
+                        (unsigned long)link.loss_percent);
+                }
+                AudioLatencyTracer::GetInstance().PrintStats();
+                PrintJsonHandlerStats();
+#endif
             }
         }
     }
 }
 
+void Application::RegisterJsonHandler(const char* type, std::function<void(const cJSON* root)> handler) {
+    json_handlers_[type].handle = std::move(handler);
+}
+
+void Application::HandleIncomingJson(const cJSON* root) {
+    auto type = cJSON_GetObjectItem(root, "type");
+    if (!cJSON_IsString(type)) {
+        ESP_LOGW(TAG, "Message type is invalid");
+        return;
+    }
+    auto it = json_handlers_.find(type->valuestring);
+    if (it == json_handlers_.end()) {
+        ESP_LOGW(TAG, "Unknown message type: %s", type->valuestring);
+        return;
+    }
+
+    auto& handler = it->second;
+    int64_t start_time = esp_timer_get_time();
+    handler.handle(root);
+    uint32_t dispatch_time = esp_timer_get_time() - start_time;
+    handler.count.fetch_add(1, std::memory_order_relaxed);
+    handler.dispatch_time_total_us.fetch_add(dispatch_time, std::memory_order_relaxed);
+    if (dispatch_time > handler.dispatch_time_max_us.load(std::memory_order_relaxed)) {
+        handler.dispatch_time_max_us.store(dispatch_time, std::memory_order_relaxed);
+    }
+}
+
+void Application::PrintJsonHandlerStats() {
+    for (auto& [type, handler] : json_handlers_) {
+        uint32_t count = handler.count.load(std::memory_order_relaxed);
+        if (count > 0) {
+            ESP_LOGI(TAG, "json %.*s: %lu messages, dispatch avg: %lu us max: %lu us", (int)type.size(), type.data(),
+                (unsigned long)count, (unsigned long)(handler.dispatch_time_total_us.load(std::memory_order_relaxed) / count),
+                (unsigned long)handler.dispatch_time_max_us.load(std::memory_order_relaxed));
+        }
+    }
+}
+
+void Application::SendQueuedAudio() {
+    /* Frames that queued up behind a slow send go out as one message where the server accepts batches, so a
+     * frame only waits for the link, never for the next frame. Full duplex sends them one by one. */
+    size_t limit = protocol_ ? protocol_->GetAudioBatchLimit() : 1;
+    if (listening_mode_ == kListeningModeRealtime) {
+        limit = 1;
+    }
+    std::unique_ptr<AudioStreamPacket> packets[AUDIO_BATCH_MAX_FRAMES];
+    const AudioStreamPacket* batch[AUDIO_BATCH_MAX_FRAMES];
+    while (true) {
+        size_t count = 0;
+        while (count < limit && (packets[count] = audio_service_.PopPacketFromSendQueue())) {
+            batch[count] = packets[count].get();
+            count++;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        bool failed = protocol_ && !protocol_->SendAudioBatch(batch, count);
+        int64_t sent_time = esp_timer_get_time();
+        for (size_t i = 0; i < count; i++) {
+            if (!failed) {
+                AudioLatencyTracer::GetInstance().Record(kLatencyStageSend, packets[i]->stage_time_us, sent_time);
+                AudioLatencyTracer::GetInstance().Record(kLatencyStageUplink, packets[i]->origin_time_us, sent_time);
+            }
+            audio_service_.RecyclePacket(std::move(packets[i]));
+        }
+        if (failed) {
+            break;
+        }
+    }
+}
+
+void Application::WarmUpAudioChannel() {
+    if (!protocol_ || device_state_ != kDeviceStateIdle || warming_audio_channel_ || protocol_->IsAudioChannelOpened()) {
+        return;
+    }
+
+    /* The connection and hello handshake take seconds, so they run in their own task and the main loop keeps
+     * serving the display, buttons and wake word. A failure here is not the user's, keep it off the screen */
+    ESP_LOGI(TAG, "Pre-connecting the audio channel");
+    warming_audio_channel_ = true;
+    xEventGroupClearBits(event_group_, MAIN_EVENT_WARM_CONNECT_DONE);
+    auto ret = xTaskCreate([](void* arg) {
+        auto app = (Application*)arg;
+        int64_t start_time = esp_timer_get_time();
+        bool opened = app->protocol_->OpenAudioChannel();
+        app->warming_audio_channel_ = false;
+        xEventGroupSetBits(app->event_group_, MAIN_EVENT_WARM_CONNECT_DONE);
+        app->Schedule([app, opened, start_time]() {
+            // A conversation that waited for the channel owns it by now
+            if (opened && app->device_state_ == kDeviceStateIdle) {
+                app->warm_channel_open_time_ = esp_timer_get_time();
+                ESP_LOGI(TAG, "Audio channel pre-connected in %ld ms",
+                    (long)((app->warm_channel_open_time_ - start_time) / 1000));
+            }
+        });
+        vTaskDelete(NULL);
+    }, "warm_connect", 2048 * 4, this, 3, NULL);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the pre-connect task");
+        warming_audio_channel_ = false;
+        xEventGroupSetBits(event_group_, MAIN_EVENT_WARM_CONNECT_DONE);
+    }
+}
+
+void Application::WaitForAudioChannelWarmUp() {
+    // A conversation starting during a pre-connect takes over its channel instead of opening a second one
+    if (warming_audio_channel_) {
+        ESP_LOGI(TAG, "Waiting for the pre-connected audio channel");
+        xEventGroupWaitBits(event_group_, MAIN_EVENT_WARM_CONNECT_DONE, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+}
+
 void Application::OnWakeWordDetected() {
     if (!protocol_) {
         return;
@@ -1027,13 +1245,18 @@ void Application::OnWakeWordDetected() {
         
         audio_service_.EncodeWakeWord();
 
-        if (!protocol_->IsAudioChannelOpened()) {
+        int64_t wake_time = esp_timer_get_time();
+        bool pre_connected = protocol_->IsAudioChannelOpened();
+        if (!pre_connected) {
             SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
+            WaitForAudioChannelWarmUp();
+            if (!protocol_->IsAudioChannelOpened() && !protocol_->OpenAudioChannel()) {
                 audio_service_.EnableWakeWordDetection(true);
                 return;
             }
         }
+        ESP_LOGI(TAG, "Audio channel ready %ld ms after the wake word (%s)",
+            (long)((esp_timer_get_time() - wake_time) / 1000), pre_connected ? "already open" : "opened");
 
         auto wake_word = audio_service_.GetLastWakeWord();
         ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
@@ -1043,7 +1266,8 @@ void Application::OnWakeWordDetected() {
         
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            protocol_->SendAudio(*packet);
+            audio_service_.RecyclePacket(std::move(packet));
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -1070,6 +1294,8 @@ void Application::AbortSpeaking(AbortReason reason) {
 
 void Application::SetListeningMode(ListeningMode mode) {
     listening_mode_ = mode;
+    // In auto stop mode the server's own VAD needs the silence to find the end of speech
+    audio_service_.EnableUplinkGate(mode != kListeningModeAutoStop);
     SetDeviceState(kDeviceStateListening);
 }
 
@@ -1079,6 +1305,9 @@ void Application::SetDeviceState(DeviceState state) {
     }
     
     clock_ticks_ = 0;
+    if (state != kDeviceStateIdle) {
+        warm_channel_open_time_ = 0;
+    }
     auto previous_state = device_state_;
     device_state_ = state;
     ESP_LOGI(TAG, "STATE: %s", STATE_STRINGS[device_state_]);
@@ -1270,7 +1499,10 @@ void Application::SetAecMode(AecMode mode) {
             break;
         }
 
-        // If the AEC mode is changed, close the audio channel
+        // If the AEC mode is changed, close the audio channel so the next one negotiates its frame duration again
+        if (protocol_) {
+            protocol_->SetPreferredFrameDuration(aec_mode_ == kAecOff ? OPUS_FRAME_DURATION_MS : MIN_OPUS_FRAME_DURATION_MS);
+        }
         if (protocol_ && protocol_->IsAudioChannelOpened()) {
             protocol_->CloseAudioChannel();
         }
@@ -1375,7 +1607,8 @@ void Application::SendSttMessage(const std::string& text) {
     // Open audio channel if not already open
     if (!protocol_->IsAudioChannelOpened()) {
         SetDeviceState(kDeviceStateConnecting);
-        if (!protocol_->OpenAudioChannel()) {
+        WaitForAudioChannelWarmUp();
+        if (!protocol_->IsAudioChannelOpened() && !protocol_->OpenAudioChannel()) {
             ESP_LOGE(TAG, "Failed to open audio channel");
             SetDeviceState(kDeviceStateIdle);
             return;
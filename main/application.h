@@ -7,9 +7,13 @@
 #include <esp_timer.h>
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <functional>
 #include <mutex>
 #include <deque>
 #include <memory>
+#include <atomic>
 
 #include "protocol.h"
 #include "ota.h"
@@ -24,6 +28,7 @@
 #define MAIN_EVENT_ERROR (1 << 4)
 #define MAIN_EVENT_CHECK_NEW_VERSION_DONE (1 << 5)
 #define MAIN_EVENT_CLOCK_TICK (1 << 6)
+#define MAIN_EVENT_WARM_CONNECT_DONE (1 << 7)  // Not handled by the main loop, see WaitForAudioChannelWarmUp()
 
 
 enum AecMode {
@@ -88,13 +93,33 @@ private:
 
     bool has_server_time_ = false;
     bool aborted_ = false;
+    std::atomic<bool> warming_audio_channel_{false};  // A speculative OpenAudioChannel runs, see WarmUpAudioChannel()
+    int64_t warm_channel_open_time_ = 0;  // When a speculative channel opened, 0 once a conversation uses it
     bool emotion_locked_ = false;  // Lock emotion during keyword trigger sequences
     std::string last_web_wake_word_;  // Track last wake word sent from web UI to skip echo
     int clock_ticks_ = 0;
     TaskHandle_t check_new_version_task_handle_ = nullptr;
     TaskHandle_t main_event_loop_task_handle_ = nullptr;
 
+    // Handler of one server message type with its counters, see RegisterJsonHandler(). The time covers the
+    // handler on the receive task, not the closures it schedules onto the main loop. Written by the receive
+    // task only, read by the main loop, hence atomics that cannot tear
+    struct JsonHandler {
+        std::function<void(const cJSON* root)> handle;
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> dispatch_time_total_us{0};  // Wraps after about 71 minutes of handler time
+        std::atomic<uint32_t> dispatch_time_max_us{0};
+    };
+    // Keyed by the literal passed to RegisterJsonHandler(), filled before the protocol starts
+    std::unordered_map<std::string_view, JsonHandler> json_handlers_;
+
     void OnWakeWordDetected();
+    void SendQueuedAudio();
+    void WarmUpAudioChannel();
+    void WaitForAudioChannelWarmUp();
+    void RegisterJsonHandler(const char* type, std::function<void(const cJSON* root)> handler);
+    void HandleIncomingJson(const cJSON* root);
+    void PrintJsonHandlerStats();
     void CheckNewVersion(Ota& ota);
     void CheckAssetsVersion();
     void ShowActivationCode(const std::string& code, const std::string& message);
@@ -3,6 +3,8 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
 #include <cstring>
 #include <driver/i2s_common.h>
 
@@ -35,6 +37,11 @@ void AudioCodec::Start() {
     }
 
     if (tx_handle_ != nullptr) {
+        i2s_event_callbacks_t callbacks = {};
+        callbacks.on_sent = OnOutputSent;
+        if (i2s_channel_register_event_callback(tx_handle_, &callbacks, this) != ESP_OK) {
+            ESP_LOGW(TAG, "Output position is not available");
+        }
         ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
     }
 
@@ -47,6 +54,24 @@ void AudioCodec::Start() {
     ESP_LOGI(TAG, "Audio codec started");
 }
 
+bool IRAM_ATTR AudioCodec::OnOutputSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    auto codec = (AudioCodec*)user_ctx;
+    portENTER_CRITICAL_ISR(&codec->output_position_lock_);
+    codec->output_position_.frames += AUDIO_CODEC_DMA_FRAME_NUM;
+    codec->output_position_.time_us = esp_timer_get_time();
+    codec->output_position_valid_ = true;
+    portEXIT_CRITICAL_ISR(&codec->output_position_lock_);
+    return false;
+}
+
+bool AudioCodec::GetOutputPosition(AudioOutputPosition& position) {
+    portENTER_CRITICAL(&output_position_lock_);
+    position = output_position_;
+    bool valid = output_position_valid_;
+    portEXIT_CRITICAL(&output_position_lock_);
+    return valid;
+}
+
 void AudioCodec::SetOutputVolume(int volume) {
     output_volume_ = volume;
     ESP_LOGI(TAG, "Set output volume to %d", output_volume_);
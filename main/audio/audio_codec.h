@@ -15,6 +15,12 @@
 #define AUDIO_CODEC_DMA_FRAME_NUM 240
 #define AUDIO_CODEC_DEFAULT_MIC_GAIN 30.0
 
+// Frames the output DMA has sent, and the esp_timer time the last of them went out
+struct AudioOutputPosition {
+    uint64_t frames = 0;
+    int64_t time_us = 0;
+};
+
 class AudioCodec {
 public:
     AudioCodec();
@@ -27,6 +33,8 @@ public:
     virtual void OutputData(std::vector<int16_t>& data);
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
+    // False when the codec has no I2S sent events, see AudioPlaybackClock
+    bool GetOutputPosition(AudioOutputPosition& position);
 
     inline bool duplex() const { return duplex_; }
     inline bool input_reference() const { return input_reference_; }
@@ -52,6 +60,13 @@ protected:
     int output_channels_ = 1;
     int output_volume_ = 70;
 
+    portMUX_TYPE output_position_lock_ = portMUX_INITIALIZER_UNLOCKED;
+    AudioOutputPosition output_position_;
+    bool output_position_valid_ = false;
+
+    // Every DMA buffer is AUDIO_CODEC_DMA_FRAME_NUM frames, whatever the slot width
+    static bool OnOutputSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
 };
@@ -0,0 +1,74 @@
+#include "audio_encoder_controller.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "AudioEncoder"
+
+// Send queue fill (percent of its limit) above which the uplink counts as backed up, and below which it is clear
+#define CONGESTED_QUEUE_PERCENT 50
+#define CLEAR_QUEUE_PERCENT 10
+// Downlink loss (percent) from which the link counts as lossy and congested
+#define LOSSY_LINK_PERCENT 5
+// Windows the uplink has to stay clear before DTX is turned off again
+#define CLEAR_WINDOWS_BEFORE_DTX_OFF 5
+// Encode time (percent of the frame duration) above which complexity is lowered, and below which it may grow
+#define HIGH_LOAD_PERCENT 50
+#define LOW_LOAD_PERCENT 20
+// Windows to wait after lowering complexity before raising it again
+#define HOLD_WINDOWS_AFTER_OVERLOAD 10
+
+void AudioEncoderController::ResetWindow() {
+    window_ms_ = 0;
+    window_encode_us_ = 0;
+    window_max_queue_ = 0;
+}
+
+bool AudioEncoderController::OnFrame(int frame_duration_ms, int64_t encode_time_us, size_t send_queue_size, size_t send_queue_limit,
+    int link_loss_percent) {
+    window_ms_ += frame_duration_ms;
+    window_encode_us_ += encode_time_us;
+    window_max_queue_ = std::max(window_max_queue_, send_queue_size);
+    if (window_ms_ < AUDIO_ENCODER_WINDOW_MS) {
+        return false;
+    }
+
+    int load = window_encode_us_ / (window_ms_ * 10);
+    int queue_fill = send_queue_limit > 0 ? window_max_queue_ * 100 / send_queue_limit : 0;
+    size_t max_queue = window_max_queue_;
+    ResetWindow();
+
+    int complexity = complexity_;
+    bool dtx = dtx_;
+    if (queue_fill >= CONGESTED_QUEUE_PERCENT || link_loss_percent >= LOSSY_LINK_PERCENT) {
+        clear_windows_ = 0;
+        dtx = true;
+    } else if (queue_fill <= CLEAR_QUEUE_PERCENT) {
+        clear_windows_++;
+        if (dtx && clear_windows_ >= CLEAR_WINDOWS_BEFORE_DTX_OFF) {
+            dtx = false;
+        }
+    } else {
+        clear_windows_ = 0;
+    }
+
+    if (hold_windows_ > 0) {
+        hold_windows_--;
+    }
+    if (load >= HIGH_LOAD_PERCENT) {
+        complexity = std::max(complexity - 2, 0);
+        hold_windows_ = HOLD_WINDOWS_AFTER_OVERLOAD;
+    } else if (load < LOW_LOAD_PERCENT && hold_windows_ == 0 && queue_fill <= CLEAR_QUEUE_PERCENT) {
+        complexity = std::min(complexity + 1, AUDIO_ENCODER_MAX_COMPLEXITY);
+    }
+
+    if (complexity == complexity_ && dtx == dtx_) {
+        return false;
+    }
+    ESP_LOGI(TAG, "complexity %d -> %d, dtx request %s -> %s (encode %d%% of frame time, send queue peak %u/%u, link loss %d%%)",
+        complexity_, complexity, dtx_ ? "on" : "off", dtx ? "on" : "off", load,
+        (unsigned)max_queue, (unsigned)send_queue_limit, link_loss_percent);
+    complexity_ = complexity;
+    dtx_ = dtx;
+    return true;
+}
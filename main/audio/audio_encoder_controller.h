@@ -0,0 +1,48 @@
+#ifndef AUDIO_ENCODER_CONTROLLER_H
+#define AUDIO_ENCODER_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define AUDIO_ENCODER_MAX_COMPLEXITY 5
+#define AUDIO_ENCODER_WINDOW_MS 1000
+
+/*
+ * Closed-loop tuning of the uplink Opus encoder.
+ *
+ * Every window of AUDIO_ENCODER_WINDOW_MS of audio, the controller looks at the encoder's CPU time
+ * per frame and at how full the send queue got:
+ *  - the send queue filling up means the uplink cannot keep pace, and downlink loss reported by the
+ *    transport means the link is dropping packets, so DTX is requested to shrink the silent frames, and
+ *    the request is withdrawn after the queue has stayed short on a clean link for a while. This only adds
+ *    to the encoder's own DTX setting, which the audio service keeps on unless configured otherwise;
+ *  - encode time above half a frame lowers the complexity by two steps and holds it there,
+ *    while a light load on a healthy uplink raises it one step per window.
+ *
+ * Only the Opus encode task calls into it.
+ */
+class AudioEncoderController {
+public:
+    AudioEncoderController() = default;
+
+    // Returns true when the settings changed and have to be applied to the encoder
+    bool OnFrame(int frame_duration_ms, int64_t encode_time_us, size_t send_queue_size, size_t send_queue_limit,
+        int link_loss_percent = 0);
+    // Starts a new measurement window, e.g. after the encoder was recreated
+    void ResetWindow();
+
+    inline int complexity() const { return complexity_; }
+    inline bool dtx() const { return dtx_; }
+
+private:
+    int complexity_ = 0;
+    bool dtx_ = false;
+    int hold_windows_ = 0;
+    int clear_windows_ = 0;
+
+    int window_ms_ = 0;
+    int64_t window_encode_us_ = 0;
+    size_t window_max_queue_ = 0;
+};
+
+#endif // AUDIO_ENCODER_CONTROLLER_H
@@ -0,0 +1,88 @@
+#include "audio_frame_pool.h"
+
+void AudioFramePool::Initialize(size_t max_tasks, size_t max_packets, size_t pcm_samples, size_t payload_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_tasks_ = max_tasks;
+    max_packets_ = max_packets;
+    pcm_samples_ = pcm_samples;
+    payload_bytes_ = payload_bytes;
+    // Reserve the free lists up front so Release never has to grow them
+    free_tasks_.reserve(max_tasks_);
+    free_packets_.reserve(max_packets_);
+}
+
+std::unique_ptr<AudioTask> AudioFramePool::AcquireTask(AudioTaskType type) {
+    std::unique_ptr<AudioTask> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_tasks_.empty()) {
+            task = std::move(free_tasks_.back());
+            free_tasks_.pop_back();
+        }
+    }
+    if (!task) {
+        task = std::make_unique<AudioTask>();
+        task->pcm.reserve(pcm_samples_);
+        alloc_count_.fetch_add(2, std::memory_order_relaxed);
+    }
+    task->type = type;
+    task->timestamp = 0;
+    task->origin_time_us = 0;
+    task->stage_time_us = 0;
+    task->pcm.clear();
+    return task;
+}
+
+std::unique_ptr<AudioStreamPacket> AudioFramePool::AcquirePacket() {
+    std::unique_ptr<AudioStreamPacket> packet;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_packets_.empty()) {
+            packet = std::move(free_packets_.back());
+            free_packets_.pop_back();
+        }
+    }
+    if (!packet) {
+        packet = std::make_unique<AudioStreamPacket>();
+        packet->payload.reserve(payload_bytes_);
+        alloc_count_.fetch_add(2, std::memory_order_relaxed);
+    }
+    packet->sample_rate = 0;
+    packet->frame_duration = 0;
+    packet->timestamp = 0;
+    packet->sequence = 0;
+    packet->has_sequence = false;
+    packet->origin_time_us = 0;
+    packet->stage_time_us = 0;
+    packet->payload.clear();
+    return packet;
+}
+
+void AudioFramePool::Release(std::unique_ptr<AudioTask>&& task) {
+    if (!task) {
+        return;
+    }
+    // A buffer that was moved out by a consumer has to be reallocated before reuse
+    if (task->pcm.capacity() < pcm_samples_) {
+        task->pcm.reserve(pcm_samples_);
+        alloc_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_tasks_.size() < max_tasks_) {
+        free_tasks_.push_back(std::move(task));
+    }
+}
+
+void AudioFramePool::Release(std::unique_ptr<AudioStreamPacket>&& packet) {
+    if (!packet) {
+        return;
+    }
+    if (packet->payload.capacity() < payload_bytes_) {
+        packet->payload.reserve(payload_bytes_);
+        alloc_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_packets_.size() < max_packets_) {
+        free_packets_.push_back(std::move(packet));
+    }
+}
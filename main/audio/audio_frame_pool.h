@@ -0,0 +1,60 @@
+#ifndef AUDIO_FRAME_POOL_H
+#define AUDIO_FRAME_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include "protocol.h"
+
+enum AudioTaskType {
+    kAudioTaskTypeEncodeToSendQueue,
+    kAudioTaskTypeEncodeToTestingQueue,
+    kAudioTaskTypeDecodeToPlaybackQueue,
+};
+
+struct AudioTask {
+    AudioTaskType type;
+    std::vector<int16_t> pcm;
+    uint32_t timestamp;
+    // Latency tracing stamps, see AudioLatencyTracer
+    int64_t origin_time_us;
+    int64_t stage_time_us;
+};
+
+/*
+ * Recycles AudioTask / AudioStreamPacket objects together with their buffers.
+ *
+ * Objects are created lazily on the first frames and then kept (up to the configured capacity)
+ * with their vectors' capacity intact, so once the pipeline is warmed up no frame needs the heap.
+ * Every allocation the pool has to make is counted in alloc_count().
+ */
+class AudioFramePool {
+public:
+    AudioFramePool() = default;
+    AudioFramePool(const AudioFramePool&) = delete;
+    AudioFramePool& operator=(const AudioFramePool&) = delete;
+
+    void Initialize(size_t max_tasks, size_t max_packets, size_t pcm_samples, size_t payload_bytes);
+
+    std::unique_ptr<AudioTask> AcquireTask(AudioTaskType type);
+    std::unique_ptr<AudioStreamPacket> AcquirePacket();
+    void Release(std::unique_ptr<AudioTask>&& task);
+    void Release(std::unique_ptr<AudioStreamPacket>&& packet);
+
+    inline uint32_t alloc_count() const { return alloc_count_.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<AudioTask>> free_tasks_;
+    std::vector<std::unique_ptr<AudioStreamPacket>> free_packets_;
+    size_t max_tasks_ = 0;
+    size_t max_packets_ = 0;
+    size_t pcm_samples_ = 0;
+    size_t payload_bytes_ = 0;
+    std::atomic<uint32_t> alloc_count_{0};
+};
+
+#endif // AUDIO_FRAME_POOL_H
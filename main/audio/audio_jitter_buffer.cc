@@ -0,0 +1,189 @@
+#include "audio_jitter_buffer.h"
+
+#include <esp_timer.h>
+#include <algorithm>
+
+// A sequence number behind the playout point is treated as a new stream after this much silence
+#define JITTER_STREAM_RESTART_US 1000000
+
+AudioJitterBuffer::AudioJitterBuffer(size_t capacity) : slots_(capacity) {
+}
+
+void AudioJitterBuffer::OnDiscard(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback) {
+    discard_callback_ = callback;
+}
+
+void AudioJitterBuffer::Discard(std::unique_ptr<AudioStreamPacket>&& packet) {
+    if (discard_callback_) {
+        discard_callback_(std::move(packet));
+    }
+    packet.reset();
+}
+
+void AudioJitterBuffer::Anchor(uint32_t sequence) {
+    next_sequence_ = sequence;
+    highest_sequence_ = sequence - 1;
+    anchored_ = true;
+    has_transit_ = false;
+}
+
+void AudioJitterBuffer::UpdateJitter(uint32_t sequence, int64_t now_us) {
+    // RFC 3550 interarrival jitter with the sequence number as media clock. Only packets that arrive
+    // later than their predecessor count, so a server sending ahead of real time does not inflate it.
+    int64_t transit = now_us - static_cast<int64_t>(sequence) * frame_duration_ms_ * 1000;
+    if (has_transit_) {
+        int64_t d = std::max<int64_t>(transit - last_transit_us_, 0);
+        jitter_us_ += (d - jitter_us_) / 16;
+    }
+    last_transit_us_ = transit;
+    has_transit_ = true;
+
+    int64_t frame_us = frame_duration_ms_ * 1000;
+    size_t depth = 1 + (2 * jitter_us_ + frame_us - 1) / frame_us;
+    target_depth_ = std::clamp<size_t>(depth, 1, slots_.size() / 2);
+}
+
+bool AudioJitterBuffer::Push(std::unique_ptr<AudioStreamPacket>&& packet) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = esp_timer_get_time();
+    bool sequenced = packet->has_sequence;
+    if (packet->frame_duration > 0) {
+        frame_duration_ms_ = packet->frame_duration;
+    }
+
+    uint32_t sequence = packet->sequence;
+    if (!sequenced) {
+        sequence = anchored_ ? highest_sequence_ + 1 : 1;
+    }
+    bool idle = count_ == 0 && !playing_;
+    if (!anchored_ || (idle && now - last_pop_us_ > JITTER_STREAM_RESTART_US)) {
+        Anchor(sequence);
+    }
+
+    int32_t offset = static_cast<int32_t>(sequence - next_sequence_);
+    if (offset < 0) {
+        late_count_++;
+        Discard(std::move(packet));
+        return true;
+    }
+    if (offset >= static_cast<int32_t>(slots_.size())) {
+        if (count_ > 0) {
+            return false;
+        }
+        // Nothing buffered to wait for, so jump forward instead of stalling the stream
+        Anchor(sequence);
+    }
+
+    auto& slot = slots_[sequence % slots_.size()];
+    if (slot) {
+        Discard(std::move(packet));
+        return true;
+    }
+    if (sequenced) {
+        UpdateJitter(sequence, now);
+    }
+    if (count_ == 0) {
+        first_arrival_us_ = now;
+    }
+    slot = std::move(packet);
+    count_++;
+    high_water_mark_ = std::max(high_water_mark_, count_);
+    if (static_cast<int32_t>(sequence - highest_sequence_) > 0) {
+        highest_sequence_ = sequence;
+    }
+    return true;
+}
+
+int64_t AudioJitterBuffer::HoldDeadlineUs() const {
+    int64_t hold_us = static_cast<int64_t>(target_depth_) * frame_duration_ms_ * 1000;
+    if (!playing_) {
+        return first_arrival_us_ + hold_us;
+    }
+    return gap_since_us_ + hold_us;
+}
+
+bool AudioJitterBuffer::Pop(std::unique_ptr<AudioStreamPacket>& packet) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packet.reset();
+    if (count_ == 0) {
+        // Underrun or end of stream, prebuffer again before the next packet is played
+        playing_ = false;
+        gap_pending_ = false;
+        return false;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (!playing_) {
+        if (count_ < target_depth_ && now < HoldDeadlineUs()) {
+            return false;
+        }
+        // Frames missed during an underrun are not worth concealing after the pause
+        while (!slots_[next_sequence_ % slots_.size()]) {
+            next_sequence_++;
+            lost_count_++;
+        }
+        playing_ = true;
+    }
+
+    auto& slot = slots_[next_sequence_ % slots_.size()];
+    if (slot) {
+        packet = std::move(slot);
+        count_--;
+        next_sequence_++;
+        gap_pending_ = false;
+        last_pop_us_ = now;
+        return true;
+    }
+
+    // The next frame is missing while later ones are already here
+    if (!gap_pending_) {
+        gap_pending_ = true;
+        gap_since_us_ = now;
+    }
+    if (count_ < target_depth_ && now < HoldDeadlineUs()) {
+        return false;
+    }
+    next_sequence_++;
+    lost_count_++;
+    gap_pending_ = false;
+    last_pop_us_ = now;
+    return true;
+}
+
+int AudioJitterBuffer::GetHoldTimeMs() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == 0 || (playing_ && !gap_pending_)) {
+        return 0;
+    }
+    int64_t remaining = HoldDeadlineUs() - esp_timer_get_time();
+    return std::max<int>((remaining + 999) / 1000, 1);
+}
+
+void AudioJitterBuffer::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : slots_) {
+        if (slot) {
+            Discard(std::move(slot));
+        }
+    }
+    count_ = 0;
+    playing_ = false;
+    gap_pending_ = false;
+    anchored_ = false;
+}
+
+size_t AudioJitterBuffer::Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+JitterBufferStatistics AudioJitterBuffer::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JitterBufferStatistics statistics;
+    statistics.late_count = late_count_;
+    statistics.lost_count = lost_count_;
+    statistics.target_depth = target_depth_;
+    statistics.jitter_ms = jitter_us_ / 1000;
+    statistics.high_water_mark = high_water_mark_;
+    return statistics;
+}
@@ -0,0 +1,87 @@
+#ifndef AUDIO_JITTER_BUFFER_H
+#define AUDIO_JITTER_BUFFER_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "protocol.h"
+
+struct JitterBufferStatistics {
+    uint32_t late_count = 0;        // Packets that arrived after their frame was already played or concealed
+    uint32_t lost_count = 0;        // Frames given up on and handed to the decoder for concealment
+    uint32_t target_depth = 0;      // Current prebuffer depth in frames
+    uint32_t jitter_ms = 0;         // Smoothed arrival jitter
+    uint32_t high_water_mark = 0;   // Most packets ever buffered at once
+};
+
+/*
+ * Downlink jitter buffer in front of the Opus decoder.
+ *
+ * Packets are stored by sequence number (packets without one are appended in arrival order), so
+ * reordered packets are played in order. Playback starts once target_depth frames are buffered or
+ * the first packet has waited that long; target_depth follows the RFC 3550 interarrival jitter of
+ * the sequenced stream. When the next frame is missing while later ones are waiting, Pop() gives
+ * up on it after the same depth or delay and reports it as lost so the caller can conceal it.
+ *
+ * Push() may be called from several tasks, Pop() only from the decoder task.
+ */
+class AudioJitterBuffer {
+public:
+    explicit AudioJitterBuffer(size_t capacity);
+
+    AudioJitterBuffer(const AudioJitterBuffer&) = delete;
+    AudioJitterBuffer& operator=(const AudioJitterBuffer&) = delete;
+
+    // Receives packets dropped as late, duplicated or cleared
+    void OnDiscard(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback);
+
+    // Takes the packet unless its frame is too far ahead to fit, in which case false is returned
+    // and the caller keeps it. Late and duplicated packets are taken and discarded.
+    bool Push(std::unique_ptr<AudioStreamPacket>&& packet);
+
+    // Returns true when the next frame is due: `packet` is then either that frame or nullptr if the
+    // frame was lost and has to be concealed. Returns false while packets are held back.
+    bool Pop(std::unique_ptr<AudioStreamPacket>& packet);
+
+    // How long the packets currently held back may still wait, 0 if nothing is held
+    int GetHoldTimeMs();
+
+    void Clear();
+    size_t Size();
+    bool Empty() { return Size() == 0; }
+    JitterBufferStatistics GetStatistics();
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<AudioStreamPacket>> slots_;
+    std::function<void(std::unique_ptr<AudioStreamPacket>&&)> discard_callback_;
+    size_t count_ = 0;
+    size_t high_water_mark_ = 0;
+    bool anchored_ = false;
+    bool playing_ = false;
+    uint32_t next_sequence_ = 0;
+    uint32_t highest_sequence_ = 0;
+    int64_t first_arrival_us_ = 0;
+    int64_t last_pop_us_ = 0;
+    bool gap_pending_ = false;
+    int64_t gap_since_us_ = 0;
+
+    int frame_duration_ms_ = 60;
+    bool has_transit_ = false;
+    int64_t last_transit_us_ = 0;
+    int64_t jitter_us_ = 0;
+    size_t target_depth_ = 1;
+    uint32_t late_count_ = 0;
+    uint32_t lost_count_ = 0;
+
+    void Anchor(uint32_t sequence);
+    void Discard(std::unique_ptr<AudioStreamPacket>&& packet);
+    void UpdateJitter(uint32_t sequence, int64_t now_us);
+    int64_t HoldDeadlineUs() const;
+};
+
+#endif // AUDIO_JITTER_BUFFER_H
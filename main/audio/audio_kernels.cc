@@ -0,0 +1,168 @@
+#include "audio_kernels.h"
+
+#include <sdkconfig.h>
+#include <algorithm>
+
+#if CONFIG_AUDIO_KERNELS_USE_ESP_DSP && __has_include(<dsps_mulc.h>)
+#include <dsps_mulc.h>
+#define AUDIO_KERNELS_USE_DSP 1
+#endif
+
+int32_t audio_volume_gain(int volume) {
+    volume = std::clamp(volume, 0, 100);
+    return volume * volume * 65536 / 10000;
+}
+
+void audio_s16_to_s32(const int16_t* __restrict in, int32_t* __restrict out, size_t samples, int32_t gain) {
+    // |sample| <= 32768 and gain <= 65536 keep the product within int32
+    gain = std::clamp<int32_t>(gain, 0, 65536);
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = in[i] * gain;
+    }
+}
+
+void audio_s32_to_s16(const int32_t* __restrict in, int16_t* __restrict out, size_t samples, int shift) {
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = in[i] >> shift;
+        value = value > INT16_MAX ? INT16_MAX : value;
+        out[i] = value < -INT16_MAX ? -INT16_MAX : value;
+    }
+}
+
+// Applies `op` to every sample. Buffers are either distinct or the same, so each case gets a loop the
+// compiler can vectorize without runtime overlap checks
+template <typename Op>
+static inline void map_s16(const int16_t* in, int16_t* out, size_t samples, Op op) {
+    if (in == out) {
+        for (size_t i = 0; i < samples; i++) {
+            out[i] = op(out[i]);
+        }
+        return;
+    }
+    const int16_t* __restrict src = in;
+    int16_t* __restrict dst = out;
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = op(src[i]);
+    }
+}
+
+void audio_scale_s16(const int16_t* in, int16_t* out, size_t samples, int32_t gain) {
+    if (gain == 65536) {
+        if (in != out) {
+            std::copy(in, in + samples, out);
+        }
+        return;
+    }
+#if AUDIO_KERNELS_USE_DSP
+    // The PIE version wants 16-byte aligned buffers and whole 8-sample vectors, anything else takes the
+    // portable loops. The Q15 constant drops the lowest bit of the gain, so results may differ by one LSB
+    if (gain >= 0 && gain < 65536 && samples % 8 == 0 &&
+        ((uintptr_t)in & 15) == 0 && ((uintptr_t)out & 15) == 0) {
+        dsps_mulc_s16(in, out, samples, gain >> 1, 1, 1);
+        return;
+    }
+#endif
+    gain = std::clamp<int32_t>(gain, 0, INT16_MAX * 65536);
+    int32_t whole = gain >> 16;
+    int32_t fraction = gain & 0xFFFF;
+    if (fraction == 0) {
+        // Whole gains, e.g. the microphone boosts, need one multiply per sample
+        map_s16(in, out, samples, [whole](int32_t sample) -> int16_t {
+            int32_t value = sample * whole;
+            value = value > INT16_MAX ? INT16_MAX : value;
+            return value < INT16_MIN ? INT16_MIN : value;
+        });
+    } else if (whole == 0) {
+        // Attenuation cannot overflow
+        map_s16(in, out, samples, [fraction](int32_t sample) -> int16_t {
+            return (sample * fraction) >> 16;
+        });
+    } else {
+        // Integer and fraction parts multiplied separately keep every product within int32
+        map_s16(in, out, samples, [whole, fraction](int32_t sample) -> int16_t {
+            int32_t value = sample * whole + ((sample * fraction) >> 16);
+            value = value > INT16_MAX ? INT16_MAX : value;
+            return value < INT16_MIN ? INT16_MIN : value;
+        });
+    }
+}
+
+void audio_mix_s16(const int16_t* __restrict in, int32_t* __restrict acc, size_t samples, int32_t gain_start, int32_t gain_end) {
+    gain_start = std::clamp<int32_t>(gain_start, 0, 65536);
+    gain_end = std::clamp<int32_t>(gain_end, 0, 65536);
+    if (gain_start == gain_end) {
+        for (size_t i = 0; i < samples; i++) {
+            acc[i] += (in[i] * gain_start) >> 16;
+        }
+        return;
+    }
+    int32_t step = samples > 0 ? (gain_end - gain_start) / static_cast<int32_t>(samples) : 0;
+    int32_t gain = gain_start;
+    for (size_t i = 0; i < samples; i++) {
+        acc[i] += (in[i] * gain) >> 16;
+        gain += step;
+    }
+}
+
+int16_t audio_fir_s16(const int16_t* __restrict in, const int16_t* __restrict coefficients, size_t taps) {
+    // esp-dsp's dsps_dotprod_s16 shifts by 15 and wants aligned input, which a sliding FIR window is not,
+    // so this stays portable to keep the exact Q14 result
+    int32_t sum = 1 << 13;
+    for (size_t i = 0; i < taps; i++) {
+        sum += in[i] * coefficients[i];
+    }
+    int32_t value = sum >> 14;
+    value = value > INT16_MAX ? INT16_MAX : value;
+    return value < INT16_MIN ? INT16_MIN : value;
+}
+
+void audio_extract_channel_s16(const int16_t* in, int16_t* out, size_t frames, int channels, int channel) {
+    // Forward order reads each frame before anything at or after it is written, so channel 0 works in place
+    if (channels == 2) {
+        // A constant stride lets the compiler vectorize the common stereo case
+        for (size_t i = 0; i < frames; i++) {
+            out[i] = in[2 * i + channel];
+        }
+        return;
+    }
+    for (size_t i = 0; i < frames; i++) {
+        out[i] = in[i * channels + channel];
+    }
+}
+
+void audio_deinterleave_s16(const int16_t* __restrict in, int16_t* __restrict left, int16_t* __restrict right, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+void audio_interleave_s16(const int16_t* left, const int16_t* right, int16_t* __restrict out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void audio_interleave_s32(const int32_t* left, const int32_t* right, int32_t* __restrict out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void audio_downmix_s16(const int16_t* in, int16_t* out, size_t frames, int channels) {
+    if (channels == 2) {
+        for (size_t i = 0; i < frames; i++) {
+            out[i] = (in[2 * i] + in[2 * i + 1]) / 2;
+        }
+        return;
+    }
+    for (size_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += in[i * channels + c];
+        }
+        out[i] = sum / channels;
+    }
+}
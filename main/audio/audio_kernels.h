@@ -0,0 +1,48 @@
+#ifndef AUDIO_KERNELS_H
+#define AUDIO_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Sample format kernels shared by the codecs and the audio service.
+ *
+ * The loops are written to be auto-vectorized (no aliasing, no branches in the body); on the ESP32-S3
+ * with CONFIG_AUDIO_KERNELS_USE_ESP_DSP the attenuating gain uses esp-dsp's PIE version for aligned buffers. Gains are Q16
+ * fixed point, so 65536 is unity. Unless noted, `in` and `out` must not overlap.
+ */
+
+// Q16 gain of a 0-100 volume, on the square law curve the I2S codecs use
+int32_t audio_volume_gain(int volume);
+
+// 16-bit samples to left-justified 32-bit I2S slots with a gain of at most unity (no saturation needed)
+void audio_s16_to_s32(const int16_t* in, int32_t* out, size_t samples, int32_t gain);
+
+// 32-bit I2S slots to 16-bit samples: shift right, then clamp to +/-32767
+void audio_s32_to_s16(const int32_t* in, int16_t* out, size_t samples, int shift);
+
+// Any gain with saturation; `in` and `out` may be the same buffer
+void audio_scale_s16(const int16_t* in, int16_t* out, size_t samples, int32_t gain);
+
+// Adds samples scaled by a Q16 gain (at most unity) into a 32-bit mix bus, ramping linearly from
+// gain_start to gain_end across the block; convert the bus back with audio_s32_to_s16(..., 0)
+void audio_mix_s16(const int16_t* in, int32_t* acc, size_t samples, int32_t gain_start, int32_t gain_end);
+
+// One FIR output: dot product of `taps` samples with a row of Q14 coefficients, rounded and clamped.
+// Q14 leaves headroom for rows whose absolute sum is up to 2, so the accumulator cannot wrap
+int16_t audio_fir_s16(const int16_t* in, const int16_t* coefficients, size_t taps);
+
+// Copies one channel out of interleaved frames; may run in place when `channel` is 0
+void audio_extract_channel_s16(const int16_t* in, int16_t* out, size_t frames, int channels, int channel);
+
+// Splits stereo frames into two planes
+void audio_deinterleave_s16(const int16_t* in, int16_t* left, int16_t* right, size_t frames);
+
+// Joins two planes into stereo frames; `left` and `right` may be the same plane
+void audio_interleave_s16(const int16_t* left, const int16_t* right, int16_t* out, size_t frames);
+void audio_interleave_s32(const int32_t* left, const int32_t* right, int32_t* out, size_t frames);
+
+// Averages the channels of each frame; may run in place
+void audio_downmix_s16(const int16_t* in, int16_t* out, size_t frames, int channels);
+
+#endif // AUDIO_KERNELS_H
@@ -0,0 +1,122 @@
+#include "audio_latency_tracer.h"
+
+#include <esp_log.h>
+#include <cJSON.h>
+#include <algorithm>
+
+#define TAG "AudioLatency"
+
+static const char* const stage_names[kLatencyStageCount] = {
+    "capture", "encode", "send", "uplink", "decode", "playback", "downlink",
+};
+
+void AudioLatencyTracer::Record(AudioLatencyStage stage, int64_t start_us, int64_t end_us) {
+    if (start_us <= 0) {
+        return;
+    }
+    uint32_t elapsed_us = end_us > start_us ? end_us - start_us : 0;
+    uint32_t elapsed_ms = elapsed_us / 1000;
+    int bucket = elapsed_ms == 0 ? 0 : std::min(32 - __builtin_clz(elapsed_ms), AUDIO_LATENCY_BUCKETS - 1);
+
+    auto& histogram = stages_[stage];
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    uint32_t max_us = histogram.max_us.load(std::memory_order_relaxed);
+    while (elapsed_us > max_us && !histogram.max_us.compare_exchange_weak(max_us, elapsed_us, std::memory_order_relaxed)) {
+    }
+}
+
+void AudioLatencyTracer::Reset() {
+    for (auto& histogram : stages_) {
+        for (auto& bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.max_us.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Upper bound in milliseconds of the bucket holding the given percentile
+uint32_t AudioLatencyTracer::Percentile(const StageHistogram& histogram, uint32_t count, int percent) const {
+    uint32_t target = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < AUDIO_LATENCY_BUCKETS - 1; i++) {
+        seen += histogram.buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return 1u << i;
+        }
+    }
+    return histogram.max_us.load(std::memory_order_relaxed) / 1000;
+}
+
+void AudioLatencyTracer::PrintStats() {
+    for (int i = 0; i < kLatencyStageCount; i++) {
+        auto& histogram = stages_[i];
+        uint32_t count = histogram.count.load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: %lu frames, p50 <= %lu ms, p95 <= %lu ms, max %lu ms", stage_names[i], (unsigned long)count,
+            (unsigned long)Percentile(histogram, count, 50), (unsigned long)Percentile(histogram, count, 95),
+            (unsigned long)(histogram.max_us.load(std::memory_order_relaxed) / 1000));
+    }
+}
+
+std::string AudioLatencyTracer::GetStatsJson() {
+    auto root = cJSON_CreateObject();
+    for (int i = 0; i < kLatencyStageCount; i++) {
+        auto& histogram = stages_[i];
+        uint32_t count = histogram.count.load(std::memory_order_relaxed);
+        auto stage = cJSON_CreateObject();
+        cJSON_AddNumberToObject(stage, "count", count);
+        if (count > 0) {
+            cJSON_AddNumberToObject(stage, "p50_ms", Percentile(histogram, count, 50));
+            cJSON_AddNumberToObject(stage, "p95_ms", Percentile(histogram, count, 95));
+            cJSON_AddNumberToObject(stage, "max_ms", histogram.max_us.load(std::memory_order_relaxed) / 1000);
+        }
+        auto buckets = cJSON_CreateArray();
+        for (auto& bucket : histogram.buckets) {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(bucket.load(std::memory_order_relaxed)));
+        }
+        cJSON_AddItemToObject(stage, "buckets", buckets);
+        cJSON_AddItemToObject(root, stage_names[i], stage);
+    }
+    cJSON_AddStringToObject(root, "buckets", "<1ms, <2ms, <4ms ... <1024ms, >=1024ms");
+    auto json_str = cJSON_PrintUnformatted(root);
+    std::string json(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return json;
+}
+
+void AudioCaptureClock::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = {};
+    next_entry_ = 0;
+    captured_samples_ = 0;
+    processed_samples_ = 0;
+}
+
+void AudioCaptureClock::OnCaptured(size_t samples, int64_t time_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    captured_samples_ += samples;
+    entries_[next_entry_ % entries_.size()] = {captured_samples_, time_us};
+    next_entry_++;
+}
+
+int64_t AudioCaptureClock::OnProcessed(size_t samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    processed_samples_ += samples;
+    if (next_entry_ == 0) {
+        return 0;
+    }
+    // Oldest captured chunk that contains the last processed sample
+    size_t oldest = next_entry_ > entries_.size() ? next_entry_ - entries_.size() : 0;
+    for (size_t i = oldest; i < next_entry_; i++) {
+        auto& entry = entries_[i % entries_.size()];
+        if (entry.end_sample >= processed_samples_) {
+            return entry.time_us;
+        }
+    }
+    return entries_[(next_entry_ - 1) % entries_.size()].time_us;
+}
@@ -0,0 +1,82 @@
+#ifndef AUDIO_LATENCY_TRACER_H
+#define AUDIO_LATENCY_TRACER_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+enum AudioLatencyStage {
+    kLatencyStageCapture,       // Mic capture -> audio processor output
+    kLatencyStageEncode,        // Audio processor output -> Opus packet (encode queue + encode)
+    kLatencyStageSend,          // Opus packet -> SendAudio returned (send queue + transport)
+    kLatencyStageUplink,        // Mic capture -> SendAudio returned
+    kLatencyStageDecode,        // OnIncomingAudio -> PCM decoded (jitter buffer + decode)
+    kLatencyStagePlayback,      // PCM decoded -> codec OutputData returned (playback queue + I2S)
+    kLatencyStageDownlink,      // OnIncomingAudio -> codec OutputData returned
+    kLatencyStageCount,
+};
+
+#define AUDIO_LATENCY_BUCKETS 12
+
+/*
+ * Per-stage latency histograms for the audio pipeline.
+ *
+ * Frames carry esp_timer stamps (AudioTask / AudioStreamPacket origin_time_us and stage_time_us) and
+ * every stage boundary calls Record(). Buckets are powers of two in milliseconds, from < 1 ms up to
+ * >= 1024 ms. All counters are relaxed atomics so any task can record without taking a lock.
+ */
+class AudioLatencyTracer {
+public:
+    static AudioLatencyTracer& GetInstance() {
+        static AudioLatencyTracer instance;
+        return instance;
+    }
+    AudioLatencyTracer(const AudioLatencyTracer&) = delete;
+    AudioLatencyTracer& operator=(const AudioLatencyTracer&) = delete;
+
+    // Stamps of 0 mean the frame was not traced (e.g. local sounds) and are ignored
+    void Record(AudioLatencyStage stage, int64_t start_us, int64_t end_us);
+    void Reset();
+    void PrintStats();
+    std::string GetStatsJson();
+
+private:
+    AudioLatencyTracer() = default;
+
+    struct StageHistogram {
+        std::array<std::atomic<uint32_t>, AUDIO_LATENCY_BUCKETS> buckets{};
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> max_us{0};
+    };
+    std::array<StageHistogram, kLatencyStageCount> stages_;
+
+    uint32_t Percentile(const StageHistogram& stage, uint32_t count, int percent) const;
+};
+
+/*
+ * Maps audio processor output back to capture time by sample position, so the capture stage
+ * includes whatever the processor buffers internally. Fed by the input task, read by the task
+ * the processor delivers its output on.
+ */
+class AudioCaptureClock {
+public:
+    void Reset();
+    void OnCaptured(size_t samples, int64_t time_us);
+    int64_t OnProcessed(size_t samples);
+
+private:
+    struct Entry {
+        uint64_t end_sample;
+        int64_t time_us;
+    };
+    std::mutex mutex_;
+    std::array<Entry, 16> entries_{};
+    size_t next_entry_ = 0;
+    uint64_t captured_samples_ = 0;
+    uint64_t processed_samples_ = 0;
+};
+
+#endif // AUDIO_LATENCY_TRACER_H
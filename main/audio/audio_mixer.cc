@@ -0,0 +1,117 @@
+#include "audio_mixer.h"
+#include "audio_kernels.h"
+
+#include <esp_timer.h>
+#include <algorithm>
+
+void AudioMixer::Initialize(size_t frame_samples) {
+    mix_buffer_.reserve(frame_samples);
+}
+
+void AudioMixer::AddStream(AudioMixerStream stream, AudioRingQueue<AudioTask>* queue, int32_t duck_gain) {
+    streams_[stream].queue = queue;
+    streams_[stream].duck_gain = std::clamp<int32_t>(duck_gain, 0, 65536);
+}
+
+void AudioMixer::SetGain(AudioMixerStream stream, int32_t gain) {
+    streams_[stream].gain.store(std::clamp<int32_t>(gain, 0, 65536), std::memory_order_relaxed);
+}
+
+bool AudioMixer::Pending() const {
+    for (auto& stream : streams_) {
+        if (stream.current || (stream.queue != nullptr && stream.queue->Pending())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<AudioTask> AudioMixer::Next() {
+    int64_t now = esp_timer_get_time();
+    Stream* lead = nullptr;
+    int active = 0;
+    for (auto& stream : streams_) {
+        if (!stream.current && stream.queue != nullptr) {
+            stream.current = stream.queue->Pop();
+            stream.offset = 0;
+        }
+        if (stream.current) {
+            stream.last_active_us = now;
+            active++;
+            if (lead == nullptr) {
+                lead = &stream;
+            }
+        }
+    }
+    if (lead == nullptr) {
+        return nullptr;
+    }
+
+    /* Target gain of each stream, ducked under any stream above it that played recently */
+    std::array<int32_t, kAudioStreamCount> target_gains;
+    bool ducked = false;
+    for (size_t i = 0; i < streams_.size(); i++) {
+        auto& stream = streams_[i];
+        int32_t gain = stream.gain.load(std::memory_order_relaxed);
+        target_gains[i] = ducked ? (int32_t)(((int64_t)gain * stream.duck_gain) >> 16) : gain;
+        if (stream.last_active_us > 0 && now - stream.last_active_us < AUDIO_MIXER_DUCK_HOLD_MS * 1000) {
+            ducked = true;
+        }
+    }
+
+    size_t lead_index = lead - streams_.data();
+    if (active == 1 && lead->offset == 0 && lead->applied_gain == 65536 && target_gains[lead_index] == 65536) {
+        return std::move(lead->current);
+    }
+    if (lead->offset >= lead->current->pcm.size()) {
+        frame_pool_.Release(std::move(lead->current));
+        return nullptr;
+    }
+
+    /* The output frame takes over the stamps of the lead frame when it starts with it */
+    auto output = frame_pool_.AcquireTask(kAudioTaskTypeDecodeToPlaybackQueue);
+    if (lead->offset == 0) {
+        output->timestamp = lead->current->timestamp;
+        output->origin_time_us = lead->current->origin_time_us;
+        output->stage_time_us = lead->current->stage_time_us;
+    }
+
+    size_t samples = lead->current->pcm.size() - lead->offset;
+    mix_buffer_.assign(samples, 0);
+    for (size_t i = 0; i < streams_.size(); i++) {
+        auto& stream = streams_[i];
+        if (stream.current) {
+            Fill(stream, samples, target_gains[i]);
+        }
+    }
+    output->pcm.resize(samples);
+    audio_s32_to_s16(mix_buffer_.data(), output->pcm.data(), samples, 0);
+    return output;
+}
+
+void AudioMixer::Fill(Stream& stream, size_t samples, int32_t target_gain) {
+    int32_t start_gain = stream.applied_gain;
+    auto gain_at = [&](size_t position) {
+        return start_gain + (int32_t)((int64_t)(target_gain - start_gain) * (int64_t)position / (int64_t)samples);
+    };
+
+    size_t filled = 0;
+    while (filled < samples) {
+        if (!stream.current) {
+            stream.current = stream.queue->Pop();
+            stream.offset = 0;
+            if (!stream.current) {
+                break;
+            }
+        }
+        size_t count = std::min(samples - filled, stream.current->pcm.size() - stream.offset);
+        audio_mix_s16(stream.current->pcm.data() + stream.offset, mix_buffer_.data() + filled, count,
+            gain_at(filled), gain_at(filled + count));
+        stream.offset += count;
+        filled += count;
+        if (stream.offset >= stream.current->pcm.size()) {
+            frame_pool_.Release(std::move(stream.current));
+        }
+    }
+    stream.applied_gain = target_gain;
+}
@@ -0,0 +1,73 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_ring_queue.h"
+#include "audio_frame_pool.h"
+
+// Gain applied to a stream while a stream of higher priority is playing
+#define AUDIO_MIXER_DUCK_GAIN 16384
+// A stream keeps ducking the ones below it for this long after its last frame, so short gaps don't pump
+#define AUDIO_MIXER_DUCK_HOLD_MS 500
+
+// Highest priority first
+enum AudioMixerStream {
+    kAudioStreamTts,
+    kAudioStreamSound,
+    kAudioStreamMusic,
+    kAudioStreamCount,
+};
+
+/*
+ * Combines the playback streams into the frames written to the codec.
+ *
+ * Every stream is an AudioRingQueue of mono PCM at the codec output rate, filled by its own producer.
+ * The highest priority stream with data sets the length of each output frame; the others contribute
+ * as many samples as they have buffered, so a stream that falls behind goes silent instead of
+ * holding the others up. Samples are summed in 32 bits and saturated once, and gain changes ramp
+ * over one frame. When a single stream plays at unity gain its frames are passed through untouched.
+ *
+ * Next() and Pending() are only called by the audio output task, SetGain() from any task.
+ */
+class AudioMixer {
+public:
+    explicit AudioMixer(AudioFramePool& frame_pool) : frame_pool_(frame_pool) {}
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    void Initialize(size_t frame_samples);
+    // duck_gain is applied while a stream of higher priority is playing
+    void AddStream(AudioMixerStream stream, AudioRingQueue<AudioTask>* queue, int32_t duck_gain);
+    // Q16 gain of a stream, at most unity
+    void SetGain(AudioMixerStream stream, int32_t gain);
+
+    // True if any stream has frames queued or partly played
+    bool Pending() const;
+    // The next frame to play, nullptr if every stream is empty
+    std::unique_ptr<AudioTask> Next();
+
+private:
+    struct Stream {
+        AudioRingQueue<AudioTask>* queue = nullptr;
+        std::atomic<int32_t> gain{65536};
+        int32_t duck_gain = 65536;
+        int32_t applied_gain = 65536;
+        std::unique_ptr<AudioTask> current;
+        size_t offset = 0;
+        int64_t last_active_us = 0;
+    };
+    AudioFramePool& frame_pool_;
+    std::array<Stream, kAudioStreamCount> streams_;
+    std::vector<int32_t> mix_buffer_;
+
+    void Fill(Stream& stream, size_t samples, int32_t target_gain);
+};
+
+#endif // AUDIO_MIXER_H
@@ -0,0 +1,86 @@
+#include "audio_playback_clock.h"
+
+#include <esp_timer.h>
+#include <algorithm>
+
+void AudioPlaybackClock::Initialize(AudioCodec* codec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    codec_ = codec;
+    sample_rate_ = codec->output_sample_rate();
+    entries_ = {};
+    next_entry_ = 0;
+    write_position_ = 0;
+    anchor_ = AudioOutputPosition();
+    dma_position_ = false;
+}
+
+void AudioPlaybackClock::UpdateAnchor() {
+    AudioOutputPosition position;
+    if (codec_->GetOutputPosition(position)) {
+        anchor_ = position;
+        dma_position_ = true;
+    }
+}
+
+int64_t AudioPlaybackClock::PositionAt(int64_t time_us) {
+    int64_t elapsed = (time_us - anchor_.time_us) * sample_rate_ / 1000000;
+    if (dma_position_) {
+        // Without a sent event since, the DMA got no further than the end of the buffer in flight
+        elapsed = std::min<int64_t>(elapsed, AUDIO_CODEC_DMA_FRAME_NUM);
+    }
+    return (int64_t)anchor_.frames + elapsed;
+}
+
+void AudioPlaybackClock::OnWrite(size_t frames, uint32_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (codec_ == nullptr || sample_rate_ <= 0) {
+        return;
+    }
+
+    UpdateAnchor();
+    if (dma_position_) {
+        // Behind the buffer in flight, if the queue ran dry and the DMA sent silence meanwhile
+        uint64_t loaded = anchor_.frames + AUDIO_CODEC_DMA_FRAME_NUM;
+        if (write_position_ < loaded) {
+            write_position_ = loaded;
+        }
+    } else {
+        int64_t now = esp_timer_get_time();
+        if ((int64_t)write_position_ <= PositionAt(now)) {
+            anchor_ = {write_position_, now};
+        }
+    }
+
+    entries_[next_entry_ % entries_.size()] = {write_position_, (uint32_t)frames, timestamp};
+    next_entry_++;
+    write_position_ += frames;
+}
+
+uint32_t AudioPlaybackClock::TimestampAt(int64_t time_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (codec_ == nullptr || sample_rate_ <= 0 || next_entry_ == 0) {
+        return 0;
+    }
+
+    UpdateAnchor();
+    int64_t played = PositionAt(time_us);
+    if (played < 0) {
+        return 0;
+    }
+    uint64_t position = played;
+    size_t oldest = next_entry_ > entries_.size() ? next_entry_ - entries_.size() : 0;
+    for (size_t i = next_entry_; i > oldest; i--) {
+        auto& entry = entries_[(i - 1) % entries_.size()];
+        if (position >= entry.start + entry.frames) {
+            // Played after this frame ended, before the next one started
+            return 0;
+        }
+        if (position >= entry.start) {
+            if (entry.timestamp == 0) {
+                return 0;
+            }
+            return entry.timestamp + (uint32_t)((position - entry.start) * 1000 / sample_rate_);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef AUDIO_PLAYBACK_CLOCK_H
+#define AUDIO_PLAYBACK_CLOCK_H
+
+#include <array>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_codec.h"
+
+// Written frames remembered, enough to look back past the DMA queue and the audio processor delay
+#define AUDIO_PLAYBACK_CLOCK_ENTRIES 32
+
+/*
+ * Follows the samples the speaker actually plays, so an uplink frame can name the downlink audio that
+ * was playing while it was captured: the echo reference for server-side AEC.
+ *
+ * Every written frame is placed on the output DMA timeline. It starts where the previous one ended, or
+ * right after the DMA buffer in flight when the queue ran dry in between. The DMA position at any time
+ * follows from the codec's last I2S sent event and the sample rate. Codecs without the events
+ * (AudioCodec::GetOutputPosition() fails) fall back to esp_timer: a frame written to an idle DMA starts
+ * playing right away.
+ *
+ * OnWrite() is called by the output task, TimestampAt() from any task.
+ */
+class AudioPlaybackClock {
+public:
+    void Initialize(AudioCodec* codec);
+    // Right before `frames` frames are written to the codec; `timestamp` is their downlink stream time in ms, 0 for none
+    void OnWrite(size_t frames, uint32_t timestamp);
+    // Downlink stream time (ms) of the sample the speaker played at time_us, 0 if nothing timestamped was playing
+    uint32_t TimestampAt(int64_t time_us);
+
+private:
+    struct Entry {
+        uint64_t start = 0;
+        uint32_t frames = 0;
+        uint32_t timestamp = 0;
+    };
+    std::mutex mutex_;
+    AudioCodec* codec_ = nullptr;
+    int sample_rate_ = 0;
+    std::array<Entry, AUDIO_PLAYBACK_CLOCK_ENTRIES> entries_{};
+    size_t next_entry_ = 0;
+    // Position on the DMA timeline of the next written frame
+    uint64_t write_position_ = 0;
+    // A DMA position and when it was reached
+    AudioOutputPosition anchor_;
+    bool dma_position_ = false;
+
+    void UpdateAnchor();
+    int64_t PositionAt(int64_t time_us);
+};
+
+#endif // AUDIO_PLAYBACK_CLOCK_H
@@ -4,23 +4,38 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <cstdint>
 
 #include <model_path.h>
 #include "audio_codec.h"
 
+struct AudioProcessorStatistics {
+    uint32_t fetch_count = 0;
+    // Audio fed but not yet fetched when a chunk comes out, i.e. the delay through the processor
+    uint32_t fetch_latency_ms = 0;
+    uint32_t fetch_latency_max_ms = 0;
+    // Samples waiting in the output ring for the next frame
+    uint32_t ring_samples = 0;
+    uint32_t ring_high_water = 0;
+};
+
 class AudioProcessor {
 public:
     virtual ~AudioProcessor() = default;
     
     virtual void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) = 0;
+    // Size of the chunks passed to the output callback, only changed while the processor is stopped
+    virtual void SetFrameDuration(int frame_duration_ms) = 0;
     virtual void Feed(std::vector<int16_t>&& data) = 0;
     virtual void Start() = 0;
     virtual void Stop() = 0;
     virtual bool IsRunning() = 0;
+    // The callback may swap the frame with a buffer of its own, the processor fills whatever it gets back
     virtual void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) = 0;
     virtual void OnVadStateChange(std::function<void(bool speaking)> callback) = 0;
     virtual size_t GetFeedSize() = 0;
     virtual void EnableDeviceAec(bool enable) = 0;
+    virtual AudioProcessorStatistics GetStatistics() = 0;
 };
 
 #endif
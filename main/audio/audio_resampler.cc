@@ -0,0 +1,167 @@
+#include "audio_resampler.h"
+#include "audio_kernels.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+
+#define TAG "AudioResampler"
+
+// Cutoff as a fraction of the lower Nyquist rate, so the transition band ends near it
+#define CUTOFF 0.82f
+// About 80 dB of stopband attenuation
+#define KAISER_BETA 8.0f
+
+struct AudioResampler::Table {
+    int up;
+    int down;
+    size_t taps;
+    std::vector<int16_t> storage;
+    const int16_t* rows;    // up rows of taps, oldest sample first, 16 byte aligned
+
+    inline const int16_t* row(int phase) const { return rows + phase * taps; }
+};
+
+static float bessel_i0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+        if (term < sum * 1e-8f) {
+            break;
+        }
+    }
+    return sum;
+}
+
+std::shared_ptr<const AudioResampler::Table> AudioResampler::GetTable(int up, int down) {
+    static std::mutex mutex;
+    static std::vector<std::weak_ptr<const Table>> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = tables.begin(); it != tables.end();) {
+        auto table = it->lock();
+        if (!table) {
+            it = tables.erase(it);
+            continue;
+        }
+        if (table->up == up && table->down == down) {
+            return table;
+        }
+        ++it;
+    }
+
+    /* Lower cutoff and proportionally more taps when decimating; rows are padded to 8 taps for the DSP */
+    auto table = std::make_shared<Table>();
+    table->up = up;
+    table->down = down;
+    size_t taps = (size_t)std::ceil((float)AUDIO_RESAMPLER_TAPS * std::max(1.0f, (float)down / up));
+    taps = (taps + 7) & ~(size_t)7;
+    table->taps = taps;
+    table->storage.resize(up * taps + 8);
+    auto base = reinterpret_cast<uintptr_t>(table->storage.data());
+    table->rows = table->storage.data() + ((16 - (base & 15)) & 15) / sizeof(int16_t);
+
+    /* Prototype at up times the input rate; tap j of phase p weighs the input sample j steps back */
+    size_t length = up * taps;
+    float center = (length - 1) / 2.0f;
+    float cutoff = CUTOFF / std::max(up, down);
+    float window_scale = 1.0f / bessel_i0(KAISER_BETA);
+    std::vector<float> row(taps);
+    auto rows = const_cast<int16_t*>(table->rows);
+    for (int phase = 0; phase < up; phase++) {
+        float sum = 0;
+        for (size_t j = 0; j < taps; j++) {
+            float t = phase + (float)j * up - center;
+            float x = cutoff * t;
+            float sinc = std::fabs(x) < 1e-6f ? 1.0f : std::sin((float)M_PI * x) / ((float)M_PI * x);
+            float w = 2.0f * t / (length - 1);
+            float window = bessel_i0(KAISER_BETA * std::sqrt(std::max(0.0f, 1.0f - w * w))) * window_scale;
+            row[j] = sinc * window;
+            sum += row[j];
+        }
+        // Every phase gets exactly unity gain at DC, so the output carries no phase-periodic ripple
+        for (size_t j = 0; j < taps; j++) {
+            rows[phase * taps + taps - 1 - j] = (int16_t)std::lround(row[j] / sum * 16384.0f);
+        }
+    }
+    tables.push_back(table);
+    ESP_LOGI(TAG, "Filter for %d/%d: %u taps per phase", up, down, (unsigned)taps);
+    return table;
+}
+
+bool AudioResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    if (input_sample_rate <= 0 || output_sample_rate <= 0 || input_sample_rate == output_sample_rate) {
+        table_.reset();
+        return input_sample_rate == output_sample_rate;
+    }
+
+    int divisor = std::gcd(input_sample_rate, output_sample_rate);
+    int up = output_sample_rate / divisor;
+    int down = input_sample_rate / divisor;
+    if (up > AUDIO_RESAMPLER_MAX_PHASES) {
+        ESP_LOGE(TAG, "Unsupported ratio %d -> %d", input_sample_rate, output_sample_rate);
+        table_.reset();
+        return false;
+    }
+    if (!table_ || table_->up != up || table_->down != down) {
+        table_ = GetTable(up, down);
+        up_ = up;
+        down_ = down;
+        taps_ = table_->taps;
+        history_.assign(2 * (taps_ - 1), 0);
+    }
+    Reset();
+    return true;
+}
+
+void AudioResampler::Reset() {
+    std::fill(history_.begin(), history_.end(), 0);
+    position_ = 0;
+    phase_ = 0;
+}
+
+size_t AudioResampler::GetOutputSamples(size_t input_samples) const {
+    if (!table_) {
+        return input_samples;
+    }
+    return ((uint64_t)input_samples * up_ + up_ - 1) / down_ + 1;
+}
+
+size_t AudioResampler::Process(const int16_t* in, size_t samples, int16_t* out) {
+    if (!table_) {
+        if (in != out) {
+            memcpy(out, in, samples * sizeof(int16_t));
+        }
+        return samples;
+    }
+
+    /* Windows that reach back into the previous block read from the history with this block appended */
+    size_t carried = taps_ - 1;
+    size_t joined = std::min(samples, carried);
+    memcpy(history_.data() + carried, in, joined * sizeof(int16_t));
+
+    size_t produced = 0;
+    while (position_ < samples) {
+        const int16_t* window = position_ < carried ? history_.data() + position_ : in + position_ - carried;
+        out[produced++] = audio_fir_s16(window, table_->row(phase_), taps_);
+        phase_ += down_;
+        position_ += phase_ / up_;
+        phase_ %= up_;
+    }
+    position_ -= samples;
+
+    /* Keep the last taps - 1 samples of [history | block] */
+    if (samples >= carried) {
+        memcpy(history_.data(), in + samples - carried, carried * sizeof(int16_t));
+    } else {
+        memmove(history_.data(), history_.data() + samples, carried * sizeof(int16_t));
+    }
+    return produced;
+}
@@ -0,0 +1,59 @@
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Taps per phase when neither rate is lower than the other; downsampling scales it by the ratio
+#define AUDIO_RESAMPLER_TAPS 32
+// Ratios that need more phases than this (unusual rates) are refused
+#define AUDIO_RESAMPLER_MAX_PHASES 1024
+
+/*
+ * Streaming polyphase resampler between two rates with a rational ratio up/down, e.g. 2/3 for
+ * 24 kHz to 16 kHz or 160/441 for 44.1 kHz to 16 kHz.
+ *
+ * The Kaiser windowed sinc is designed once per ratio and stored as one row of Q14 taps per phase,
+ * shared by all resamplers with the same ratio. An output sample is a single audio_fir_s16() over the
+ * newest input samples. The last taps - 1 input samples are carried over, so blocks of any size join
+ * seamlessly, and nothing is allocated after Configure(). The filter delays the stream by about
+ * taps / 2 input samples.
+ */
+class AudioResampler {
+public:
+    AudioResampler() = default;
+    AudioResampler(const AudioResampler&) = delete;
+    AudioResampler& operator=(const AudioResampler&) = delete;
+
+    // Keeps the filter when the ratio is unchanged, and only clears the carried samples
+    bool Configure(int input_sample_rate, int output_sample_rate);
+    void Reset();
+
+    inline int input_sample_rate() const { return input_sample_rate_; }
+    inline int output_sample_rate() const { return output_sample_rate_; }
+    inline size_t taps() const { return taps_; }
+    // Upper bound of the samples Process() writes for the given input
+    size_t GetOutputSamples(size_t input_samples) const;
+    // Returns the number of samples written to out; copies the input when not configured
+    size_t Process(const int16_t* in, size_t samples, int16_t* out);
+
+private:
+    struct Table;
+    static std::shared_ptr<const Table> GetTable(int up, int down);
+
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    std::shared_ptr<const Table> table_;
+    int up_ = 1;
+    int down_ = 1;
+    size_t taps_ = 0;
+    // Next output: its window starts at position_ in [history | block], using row phase_
+    size_t position_ = 0;
+    int phase_ = 0;
+    // The last taps - 1 input samples, followed by room for as many samples of the next block
+    std::vector<int16_t> history_;
+};
+
+#endif // AUDIO_RESAMPLER_H
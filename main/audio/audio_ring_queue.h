@@ -0,0 +1,129 @@
+#ifndef AUDIO_RING_QUEUE_H
+#define AUDIO_RING_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Bounded single-producer / single-consumer ring of owned items.
+ *
+ * Push() must only be called from the producer task and Pop() only from the consumer task.
+ * Clear() may be called from any task: it marks everything pushed so far as discarded, and the
+ * consumer releases those slots on its next Pop(). Consumers should therefore wait on
+ * Pending() (raw occupancy) rather than on Size() so a pending clear always gets reclaimed.
+ *
+ * Indices are free-running counters, so all comparisons are done on unsigned differences.
+ * SetLimit() lowers the usable depth below the allocated capacity, e.g. to keep a queue at a fixed
+ * duration when the frame size changes.
+ */
+template <typename T>
+class AudioRingQueue {
+public:
+    explicit AudioRingQueue(size_t capacity) : slots_(capacity), limit_(capacity) {}
+
+    AudioRingQueue(const AudioRingQueue&) = delete;
+    AudioRingQueue& operator=(const AudioRingQueue&) = delete;
+
+    inline size_t capacity() const { return slots_.size(); }
+    inline size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    // Any task: items already queued above a lowered limit stay until popped
+    void SetLimit(size_t limit) {
+        limit_.store(std::clamp<size_t>(limit, 1, slots_.size()), std::memory_order_relaxed);
+    }
+
+    // Optional hook receiving the items discarded by Clear(), called from the consumer task
+    void OnDiscard(std::function<void(std::unique_ptr<T>&&)> callback) {
+        discard_callback_ = callback;
+    }
+
+    // Producer side
+    bool Push(std::unique_ptr<T>&& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        if (tail - head >= limit()) {
+            return false;
+        }
+        slots_[tail % slots_.size()] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        if (tail + 1 - head > high_water_mark_.load(std::memory_order_relaxed)) {
+            high_water_mark_.store(tail + 1 - head, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side, returns nullptr if there is nothing live to pop
+    std::unique_ptr<T> Pop() {
+        // flush_to_ is a past value of tail_, so it must be read before tail_
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t flush = flush_to_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        if (IsAfter(flush, head)) {
+            while (head != flush) {
+                auto& slot = slots_[head % slots_.size()];
+                if (discard_callback_) {
+                    discard_callback_(std::move(slot));
+                }
+                slot.reset();
+                head++;
+            }
+            head_.store(head, std::memory_order_release);
+        }
+        if (head == tail) {
+            return nullptr;
+        }
+        auto item = std::move(slots_[head % slots_.size()]);
+        head_.store(head + 1, std::memory_order_release);
+        return item;
+    }
+
+    // Any task: discard everything pushed so far
+    void Clear() {
+        flush_to_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Number of live items (excluding items discarded by Clear)
+    size_t Size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t flush = flush_to_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        if (IsAfter(flush, head)) {
+            head = flush;
+        }
+        return tail - head;
+    }
+
+    inline bool Empty() const { return Size() == 0; }
+
+    // Raw occupancy, including slots the consumer still has to reclaim
+    inline bool Pending() const {
+        return tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_acquire);
+    }
+
+    // Highest occupancy seen by the producer since construction
+    inline size_t HighWaterMark() const { return high_water_mark_.load(std::memory_order_relaxed); }
+
+    inline bool Full() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) >= limit();
+    }
+
+private:
+    std::vector<std::unique_ptr<T>> slots_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> flush_to_{0};
+    std::atomic<size_t> high_water_mark_{0};
+    std::atomic<size_t> limit_;
+    std::function<void(std::unique_ptr<T>&&)> discard_callback_;
+
+    static inline bool IsAfter(size_t a, size_t b) {
+        return static_cast<std::ptrdiff_t>(a - b) > 0;
+    }
+};
+
+#endif // AUDIO_RING_QUEUE_H
@@ -1,6 +1,9 @@
 #include "audio_service.h"
+#include "audio_kernels.h"
 #include <esp_log.h>
+#include <esp_attr.h>
 #include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -17,40 +20,123 @@
 
 #define TAG "AudioService"
 
+static void record_frame_time(uint64_t& total_us, uint32_t& max_us, int64_t elapsed_us) {
+    total_us += elapsed_us;
+    if (elapsed_us > max_us) {
+        max_us = elapsed_us;
+    }
+}
+
+#if CONFIG_AUDIO_HEAP_ALLOC_TRACKING
+/* Count every allocation made on the audio tasks, to verify that the steady-state path is allocation free */
+static std::atomic<uint32_t> audio_task_heap_allocs{0};
+static TaskHandle_t audio_task_handles[4] = {};
+
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    for (auto handle : audio_task_handles) {
+        if (handle != nullptr && handle == current) {
+            audio_task_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+#endif
 
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
+    queue_event_group_ = xEventGroupCreate();
 }
 
 AudioService::~AudioService() {
     if (event_group_ != nullptr) {
         vEventGroupDelete(event_group_);
     }
+    if (queue_event_group_ != nullptr) {
+        vEventGroupDelete(queue_event_group_);
+    }
 }
 
 
 void AudioService::Initialize(AudioCodec* codec) {
     codec_ = codec;
     codec_->Start();
+    playback_clock_.Initialize(codec);
 
     /* Setup the audio codec */
     opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
     opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    ApplyEncoderSettings();
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
     }
 
+    /* Size the frame pool and scratch buffers for one frame at the fastest codec rate */
+    size_t frame_samples = OPUS_FRAME_DURATION_MS * std::max({16000, codec->input_sample_rate(), codec->output_sample_rate()}) / 1000;
+    size_t input_samples = OPUS_FRAME_DURATION_MS * codec->input_sample_rate() / 1000;
+    size_t payload_bytes = OPUS_FRAME_DURATION_MS * AUDIO_PACKET_MAX_BITRATE / 8 / 1000;
+    frame_pool_.Initialize(MAX_ENCODE_TASKS_IN_QUEUE + 2 * MAX_PLAYBACK_TASKS_IN_QUEUE + MAX_MUSIC_TASKS_IN_QUEUE + kAudioStreamCount + 3,
+        MAX_SEND_PACKETS_IN_QUEUE + MAX_DECODE_PACKETS_IN_QUEUE + AUDIO_UPLINK_PREROLL_MS / AUDIO_UPLINK_MIN_FRAME_MS + 5,
+        frame_samples, payload_bytes);
+    mixer_.Initialize(frame_samples);
+    mixer_.AddStream(kAudioStreamTts, &audio_playback_queue_, 65536);
+    mixer_.AddStream(kAudioStreamSound, &sound_playback_queue_, 65536);
+    mixer_.AddStream(kAudioStreamMusic, &music_playback_queue_, AUDIO_MIXER_DUCK_GAIN);
+    audio_send_queue_.SetLimit(2400 / encode_frame_duration_ms_);
+    input_buffer_.reserve(input_samples * codec->input_channels());
+    input_channel_buffer_.reserve(input_samples);
+    reference_channel_buffer_.reserve(input_samples);
+    resampled_input_buffer_.reserve(frame_samples);
+    resampled_reference_buffer_.reserve(frame_samples);
+    output_resample_buffer_.reserve(frame_samples);
+
+    /* Items dropped by Clear() go back to the pool instead of the heap */
+    auto release_packet = [this](std::unique_ptr<AudioStreamPacket>&& packet) {
+        frame_pool_.Release(std::move(packet));
+    };
+    auto release_task = [this](std::unique_ptr<AudioTask>&& task) {
+        frame_pool_.Release(std::move(task));
+    };
+    audio_jitter_buffer_.OnDiscard(release_packet);
+    audio_send_queue_.OnDiscard(release_packet);
+    audio_testing_queue_.OnDiscard(release_packet);
+    audio_encode_queue_.OnDiscard(release_task);
+    audio_playback_queue_.OnDiscard(release_task);
+    sound_playback_queue_.OnDiscard(release_task);
+    music_playback_queue_.OnDiscard(release_task);
+    uplink_gate_.OnDrop(release_packet);
+    uplink_gate_.OnSend([this](std::unique_ptr<AudioStreamPacket>&& packet) {
+        if (!audio_send_queue_.Push(std::move(packet))) {
+            frame_pool_.Release(std::move(packet));
+            return;
+        }
+        if (callbacks_.on_send_queue_available) {
+            callbacks_.on_send_queue_available();
+        }
+    });
+#if CONFIG_UPLINK_SILENCE_SUPPRESS
+    uplink_gate_.SetMode(kUplinkGateSuppress);
+#endif
+
 #if CONFIG_USE_AUDIO_PROCESSOR
     audio_processor_ = std::make_unique<AfeAudioProcessor>();
 #else
     audio_processor_ = std::make_unique<NoAudioProcessor>();
 #endif
 
+#if CONFIG_USE_AUDIO_DEBUGGER
+    audio_debugger_ = std::make_unique<AudioDebugger>();
+#endif
+
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+        int64_t capture_time = capture_clock_.OnProcessed(data.size());
+        AudioLatencyTracer::GetInstance().Record(kLatencyStageCapture, capture_time, esp_timer_get_time());
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugTapProcessed, data.data(), data.size(), 16000, capture_time);
+#endif
+        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data), capture_time);
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -77,7 +163,12 @@ void AudioService::Start() {
     service_stopped_ = false;
     xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    esp_timer_start_periodic(audio_power_timer_, 1000000);
+    {
+        std::lock_guard<std::mutex> lock(codec_power_mutex_);
+        last_input_time_ = last_output_time_ = std::chrono::steady_clock::now();
+        codec_power_changed_us_ = esp_timer_get_time();
+        ScheduleAudioPowerCheck(AUDIO_POWER_TIMEOUT_MS);
+    }
 
 #if CONFIG_USE_AUDIO_PROCESSOR
     /* Start the audio input task */
@@ -109,81 +200,101 @@ void AudioService::Start() {
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task */
-    xTaskCreate([](void* arg) {
+    /* Start the opus decode and encode tasks, on different cores where there are two so a slow frame
+     * in one direction never delays the other */
+#if CONFIG_SOC_CPU_CORES_NUM > 1
+    const BaseType_t opus_decode_core = 0;
+    const BaseType_t opus_encode_core = 1;
+#else
+    const BaseType_t opus_decode_core = tskNO_AFFINITY;
+    const BaseType_t opus_encode_core = tskNO_AFFINITY;
+#endif
+    xTaskCreatePinnedToCore([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
-        audio_service->OpusCodecTask();
+        audio_service->OpusDecodeTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);
+    }, "opus_decode", 2048 * 6, this, 3, &opus_decode_task_handle_, opus_decode_core);
+
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusEncodeTask();
+        vTaskDelete(NULL);
+    }, "opus_encode", 2048 * 13, this, 2, &opus_encode_task_handle_, opus_encode_core);
+
+#if CONFIG_AUDIO_HEAP_ALLOC_TRACKING
+    audio_task_handles[0] = audio_input_task_handle_;
+    audio_task_handles[1] = audio_output_task_handle_;
+    audio_task_handles[2] = opus_decode_task_handle_;
+    audio_task_handles[3] = opus_encode_task_handle_;
+#endif
 }
 
 void AudioService::Stop() {
-    esp_timer_stop(audio_power_timer_);
+    {
+        std::lock_guard<std::mutex> lock(codec_power_mutex_);
+        esp_timer_stop(audio_power_timer_);
+        audio_power_check_us_ = 0;
+    }
     service_stopped_ = true;
     xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    audio_encode_queue_.Clear();
+    audio_jitter_buffer_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_ALL_EVENTS);
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
     if (!codec_->input_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableInput(true);
+        std::lock_guard<std::mutex> lock(codec_power_mutex_);
+        EnableCodecInput(true);
     }
 
-    if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
-        if (!codec_->InputData(data)) {
-            return false;
+    data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
+    if (!codec_->InputData(data)) {
+        return false;
+    }
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+    /* Raw codec input, stamped with the capture time of its first frame */
+    {
+        size_t frames = data.size() / codec_->input_channels();
+        int64_t capture_time = esp_timer_get_time() - (int64_t)frames * 1000000 / codec_->input_sample_rate();
+        audio_debugger_->Feed(kAudioDebugTapMic, data.data(), frames, codec_->input_sample_rate(), capture_time,
+            codec_->input_channels());
+        if (codec_->input_channels() == 2) {
+            audio_debugger_->Feed(kAudioDebugTapReference, data.data() + 1, frames, codec_->input_sample_rate(),
+                capture_time, 2);
         }
+    }
+#endif
+
+    if (codec_->input_sample_rate() != sample_rate) {
         if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
-            }
+            size_t frames = data.size() / 2;
+            input_channel_buffer_.resize(frames);
+            reference_channel_buffer_.resize(frames);
+            audio_deinterleave_s16(data.data(), input_channel_buffer_.data(), reference_channel_buffer_.data(), frames);
+            resampled_input_buffer_.resize(input_resampler_.GetOutputSamples(frames));
+            resampled_reference_buffer_.resize(reference_resampler_.GetOutputSamples(frames));
+            resampled_input_buffer_.resize(input_resampler_.Process(input_channel_buffer_.data(), frames, resampled_input_buffer_.data()));
+            resampled_reference_buffer_.resize(reference_resampler_.Process(reference_channel_buffer_.data(), frames, resampled_reference_buffer_.data()));
+            data.resize(resampled_input_buffer_.size() + resampled_reference_buffer_.size());
+            audio_interleave_s16(resampled_input_buffer_.data(), resampled_reference_buffer_.data(), data.data(),
+                resampled_input_buffer_.size());
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
-        }
-    } else {
-        data.resize(samples * codec_->input_channels());
-        if (!codec_->InputData(data)) {
-            return false;
+            resampled_input_buffer_.resize(input_resampler_.GetOutputSamples(data.size()));
+            resampled_input_buffer_.resize(input_resampler_.Process(data.data(), data.size(), resampled_input_buffer_.data()));
+            data.assign(resampled_input_buffer_.begin(), resampled_input_buffer_.end());
         }
     }
 
     /* Update the last input time */
     last_input_time_ = std::chrono::steady_clock::now();
     debug_statistics_.input_count++;
-
-#if CONFIG_USE_AUDIO_DEBUGGER
-    // 音频调试：发送原始音频数据
-    if (audio_debugger_ == nullptr) {
-        audio_debugger_ = std::make_unique<AudioDebugger>();
-    }
-    audio_debugger_->Feed(data);
-#endif
-
     return true;
 }
 
@@ -204,33 +315,31 @@ void AudioService::AudioInputTask() {
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.Size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
             if (ReadAudioData(data, 16000, samples)) {
                 // If input channels is 2, we need to fetch the left channel data
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
+                    audio_extract_channel_s16(data.data(), data.data(), data.size() / 2, 2, 0);
+                    data.resize(data.size() / 2);
                 }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, data, esp_timer_get_time());
                 continue;
             }
         }
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
+                    CheckAudioActivity(data);
                     wake_word_->Feed(data);
                     continue;
                 }
@@ -239,10 +348,11 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
+                    capture_clock_.OnCaptured(samples, esp_timer_get_time());
                     audio_processor_->Feed(std::move(data));
                     continue;
                 }
@@ -256,119 +366,283 @@ void AudioService::AudioInputTask() {
     ESP_LOGW(TAG, "Audio input task stopped");
 }
 
+void AudioService::CheckAudioActivity(const std::vector<int16_t>& data) {
+    if (!callbacks_.on_audio_activity) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (last_activity_time_us_ != 0 && now - last_activity_time_us_ < AUDIO_ACTIVITY_INTERVAL_MS * 1000LL) {
+        return;
+    }
+
+    /* Energy of the microphone channel, the reference channel is interleaved behind it */
+    int channels = codec_->input_channels();
+    size_t frames = data.size() / channels;
+    int64_t energy = 0;
+    for (size_t i = 0; i < frames; i++) {
+        int32_t sample = data[i * channels];
+        energy += sample * sample;
+    }
+    if (frames > 0 && energy > (int64_t)AUDIO_ACTIVITY_THRESHOLD * AUDIO_ACTIVITY_THRESHOLD * (int64_t)frames) {
+        last_activity_time_us_ = now;
+        callbacks_.on_audio_activity();
+    }
+}
+
 void AudioService::AudioOutputTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
+        while (!service_stopped_ && !mixer_.Pending()) {
+            xEventGroupWaitBits(queue_event_group_, AS_QUEUE_PLAYBACK_PUSHED, pdTRUE, pdFALSE, portMAX_DELAY);
+        }
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        /* The only writer to the codec, every playback stream goes through the mixer */
+        auto task = mixer_.Next();
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_POPPED);
+        if (!task) {
+            continue;
+        }
 
         if (!codec_->output_enabled()) {
-            esp_timer_stop(audio_power_timer_);
-            esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-            codec_->EnableOutput(true);
+            std::lock_guard<std::mutex> lock(codec_power_mutex_);
+            EnableCodecOutput(true);
         }
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugTapPlayback, task->pcm.data(), task->pcm.size(), codec_->output_sample_rate(),
+            esp_timer_get_time());
+#endif
+#if CONFIG_USE_SERVER_AEC
+        playback_clock_.OnWrite(task->pcm.size(), task->timestamp);
+#endif
         codec_->OutputData(task->pcm);
+        int64_t output_time = esp_timer_get_time();
+        AudioLatencyTracer::GetInstance().Record(kLatencyStagePlayback, task->stage_time_us, output_time);
+        AudioLatencyTracer::GetInstance().Record(kLatencyStageDownlink, task->origin_time_us, output_time);
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
         debug_statistics_.playback_count++;
 
-#if CONFIG_USE_SERVER_AEC
-        /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
-        }
-#endif
+        frame_pool_.Release(std::move(task));
     }
 
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
-void AudioService::OpusCodecTask() {
+void AudioService::OpusDecodeTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
+        /* Audio testing packets are played back once the recording has stopped */
+        bool testing_replay = audio_testing_queue_.Pending() &&
+            !(xEventGroupGetBits(event_group_) & AS_EVENT_AUDIO_TESTING_RUNNING);
+        bool can_decode = (!audio_jitter_buffer_.Empty() || testing_replay) && !audio_playback_queue_.Full();
+        bool sound_due = !sound_playback_queue_.Full() && HasPendingSound();
         if (service_stopped_) {
             break;
         }
+        if (sound_due) {
+            DecodeSoundFrame();
+        }
+        if (!can_decode) {
+            if (!sound_due) {
+                xEventGroupWaitBits(queue_event_group_, AS_QUEUE_DECODE_PUSHED | AS_QUEUE_PLAYBACK_POPPED,
+                    pdTRUE, pdFALSE, portMAX_DELAY);
+            }
+            continue;
+        }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
+        std::unique_ptr<AudioStreamPacket> packet;
+        bool frame_due = audio_jitter_buffer_.Pop(packet);
+        if (frame_due) {
+            xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_POPPED);
+        } else if (testing_replay) {
+            packet = audio_testing_queue_.Pop();
+            frame_due = packet != nullptr;
+        }
 
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
+        if (!frame_due) {
+            /* The jitter buffer is holding packets back, check again when the hold expires */
+            int hold_ms = audio_jitter_buffer_.GetHoldTimeMs();
+            if (hold_ms > 0) {
+                xEventGroupWaitBits(queue_event_group_, AS_QUEUE_DECODE_PUSHED | AS_QUEUE_PLAYBACK_POPPED,
+                    pdTRUE, pdFALSE, pdMS_TO_TICKS(hold_ms));
+            }
+            continue;
+        }
 
+        int64_t start_time = esp_timer_get_time();
+        auto task = frame_pool_.AcquireTask(kAudioTaskTypeDecodeToPlaybackQueue);
+        bool decoded;
+        if (packet) {
+            task->timestamp = packet->timestamp;
+            task->origin_time_us = packet->origin_time_us;
             SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
+            decoded = opus_decoder_->Decode(std::move(packet->payload), task->pcm);
+        } else {
+            // An empty payload makes the Opus decoder run its packet loss concealment. In-band FEC would
+            // rebuild this frame from the next packet instead, but OpusDecoderWrapper (esp-opus-encoder)
+            // does not expose the decode_fec flag of opus_decode(), so every lost frame is concealed.
+            decoded = opus_decoder_->Decode(std::vector<uint8_t>(), task->pcm);
+            if (decoded) {
+                debug_statistics_.concealed_frame_count++;
+            }
+        }
+        if (decoded) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+            audio_debugger_->Feed(kAudioDebugTapDecoded, task->pcm.data(), task->pcm.size(), opus_decoder_->sample_rate(),
+                esp_timer_get_time());
+#endif
+            // Resample if the sample rate is different
+            if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+                output_resample_buffer_.resize(output_resampler_.GetOutputSamples(task->pcm.size()));
+                output_resample_buffer_.resize(output_resampler_.Process(task->pcm.data(), task->pcm.size(), output_resample_buffer_.data()));
+                task->pcm.swap(output_resample_buffer_);
+            }
+            task->stage_time_us = esp_timer_get_time();
+            AudioLatencyTracer::GetInstance().Record(kLatencyStageDecode, task->origin_time_us, task->stage_time_us);
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
+            audio_playback_queue_.Push(std::move(task));
+            xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_PUSHED);
+        } else {
+            ESP_LOGE(TAG, "Failed to decode audio");
+        }
+        frame_pool_.Release(std::move(task));
+        frame_pool_.Release(std::move(packet));
+        record_frame_time(debug_statistics_.decode_time_total_us, debug_statistics_.decode_time_max_us,
+            esp_timer_get_time() - start_time);
+        debug_statistics_.decode_count++;
+    }
+
+    ESP_LOGW(TAG, "Opus decode task stopped");
+}
+
+void AudioService::OpusEncodeTask() {
+    while (true) {
+        bool can_encode = audio_encode_queue_.Pending() && !audio_send_queue_.Full();
+        if (service_stopped_) {
+            break;
+        }
+        if (!can_encode) {
+            xEventGroupWaitBits(queue_event_group_, AS_QUEUE_ENCODE_PUSHED | AS_QUEUE_SEND_POPPED,
+                pdTRUE, pdFALSE, portMAX_DELAY);
+            continue;
+        }
+
+        auto task = audio_encode_queue_.Pop();
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_ENCODE_POPPED);
+        if (!task) {
+            continue;
+        }
+
+        /* The frame duration follows the PCM chunks, which change when a session negotiates another duration */
+        int frame_duration = task->pcm.size() * 1000 / 16000;
+        if (frame_duration != opus_encoder_->duration_ms()) {
+            ESP_LOGI(TAG, "Opus encoder frame duration: %d ms", frame_duration);
+            opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, frame_duration);
+            ApplyEncoderSettings();
+            encoder_controller_.ResetWindow();
+        } else if (encoder_dtx_ != EncoderDtx()) {
+            ApplyEncoderSettings();
+        }
+        int64_t start_time = esp_timer_get_time();
+        auto packet = frame_pool_.AcquirePacket();
+        packet->frame_duration = frame_duration;
+        packet->sample_rate = 16000;
+        packet->timestamp = task->timestamp;
+        packet->origin_time_us = task->origin_time_us;
+        int64_t queued_time = task->stage_time_us;
+        bool encoded = opus_encoder_->Encode(std::move(task->pcm), packet->payload);
+        auto type = task->type;
+        frame_pool_.Release(std::move(task));
+        int64_t encode_time = esp_timer_get_time() - start_time;
+        record_frame_time(debug_statistics_.encode_time_total_us, debug_statistics_.encode_time_max_us, encode_time);
+        if (!encoded) {
+            ESP_LOGE(TAG, "Failed to encode audio");
+            frame_pool_.Release(std::move(packet));
+            continue;
+        }
+        packet->stage_time_us = esp_timer_get_time();
+        AudioLatencyTracer::GetInstance().Record(kLatencyStageEncode, queued_time, packet->stage_time_us);
+
+        if (type == kAudioTaskTypeEncodeToSendQueue) {
+            uplink_gate_.Push(std::move(packet), voice_detected_);
+            if (encoder_controller_.OnFrame(frame_duration, encode_time, audio_send_queue_.Size(), audio_send_queue_.limit(),
+                link_loss_percent_.load(std::memory_order_relaxed))) {
+                ApplyEncoderSettings();
             }
-            debug_statistics_.decode_count++;
-        }
-        
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
+        } else if (type == kAudioTaskTypeEncodeToTestingQueue) {
+            if (!audio_testing_queue_.Push(std::move(packet))) {
+                ESP_LOGW(TAG, "Audio testing queue is full, dropping packet");
+                frame_pool_.Release(std::move(packet));
             }
+        }
+        debug_statistics_.encode_count++;
+    }
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
-                }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
+    ESP_LOGW(TAG, "Opus encode task stopped");
+}
+
+bool AudioService::HasPendingSound() {
+    std::lock_guard<std::mutex> lock(sound_mutex_);
+    return !pending_sounds_.empty();
+}
+
+void AudioService::DecodeSoundFrame() {
+    const OggSoundIndex* sound;
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(sound_mutex_);
+        if (pending_sounds_.empty()) {
+            return;
+        }
+        auto& pending = pending_sounds_.front();
+        sound = pending.sound;
+        index = pending.next_packet++;
+        if (pending.next_packet >= sound->packet_count) {
+            pending_sounds_.pop_front();
+        }
+    }
+
+    int64_t start_time = esp_timer_get_time();
+    auto task = frame_pool_.AcquireTask(kAudioTaskTypeDecodeToPlaybackQueue);
+    if (!sound_pcm_cache_.Lookup(sound, index, task->pcm)) {
+        if (!sound_decoder_ || sound_decoder_->sample_rate() != sound->sample_rate) {
+            sound_decoder_ = std::make_unique<OpusDecoderWrapper>(sound->sample_rate, 1, OPUS_FRAME_DURATION_MS);
+            if (sound->sample_rate != codec_->output_sample_rate()) {
+                sound_resampler_.Configure(sound->sample_rate, codec_->output_sample_rate());
             }
-            debug_statistics_.encode_count++;
-            lock.lock();
+        } else if (index == 0) {
+            sound_decoder_->ResetState();
+        }
+
+        /* The only copy of an embedded sound packet, into a pooled payload buffer */
+        auto packet = frame_pool_.AcquirePacket();
+        auto& ref = sound->packets[index];
+        auto data = reinterpret_cast<const uint8_t*>(sound->data) + ref.offset;
+        packet->payload.assign(data, data + ref.size);
+        bool decoded = sound_decoder_->Decode(std::move(packet->payload), task->pcm);
+        frame_pool_.Release(std::move(packet));
+        if (!decoded) {
+            ESP_LOGE(TAG, "Failed to decode sound");
+            frame_pool_.Release(std::move(task));
+            return;
         }
+        if (sound->sample_rate != codec_->output_sample_rate()) {
+            output_resample_buffer_.resize(sound_resampler_.GetOutputSamples(task->pcm.size()));
+            output_resample_buffer_.resize(sound_resampler_.Process(task->pcm.data(), task->pcm.size(), output_resample_buffer_.data()));
+            task->pcm.swap(output_resample_buffer_);
+        }
+        sound_pcm_cache_.Store(sound, index, task->pcm);
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    sound_playback_queue_.Push(std::move(task));
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_PUSHED);
+    /* Only reached if the push failed */
+    frame_pool_.Release(std::move(task));
+    record_frame_time(debug_statistics_.decode_time_total_us, debug_statistics_.decode_time_max_us,
+        esp_timer_get_time() - start_time);
+    debug_statistics_.decode_count++;
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -386,54 +660,71 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
     }
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
-    task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, const std::vector<int16_t>& pcm, int64_t capture_time_us) {
+    auto task = frame_pool_.AcquireTask(type);
+    task->pcm.assign(pcm.begin(), pcm.end());
+    PushTaskToEncodeQueue(std::move(task), capture_time_us);
+}
 
-    /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
-        }
-        timestamp_queue_.pop_front();
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm, int64_t capture_time_us) {
+    /* Take the frame and leave the pooled buffer with the producer to fill next, nothing is copied or allocated */
+    auto task = frame_pool_.AcquireTask(type);
+    task->pcm.swap(pcm);
+    PushTaskToEncodeQueue(std::move(task), capture_time_us);
+}
+
+void AudioService::PushTaskToEncodeQueue(std::unique_ptr<AudioTask>&& task, int64_t capture_time_us) {
+    task->origin_time_us = capture_time_us;
+    task->stage_time_us = esp_timer_get_time();
+
+#if CONFIG_USE_SERVER_AEC
+    /* Frames to send carry the downlink audio the speaker played when their first sample was captured */
+    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+        int64_t frame_us = (int64_t)task->pcm.size() * 1000000 / 16000;
+        task->timestamp = playback_clock_.TimestampAt(capture_time_us - frame_us);
     }
+#endif
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    /* Push the task to the encode queue, waiting for the opus task to make room */
+    while (!audio_encode_queue_.Push(std::move(task))) {
+        if (service_stopped_) {
+            frame_pool_.Release(std::move(task));
+            return;
+        }
+        xEventGroupWaitBits(queue_event_group_, AS_QUEUE_ENCODE_POPPED, pdTRUE, pdFALSE, portMAX_DELAY);
+    }
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_ENCODE_PUSHED);
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    while (!audio_jitter_buffer_.Push(std::move(packet))) {
+        if (!wait || service_stopped_) {
+            frame_pool_.Release(std::move(packet));
             return false;
         }
+        // Several producers may wait here, so poll at frame rate instead of relying on a single wake-up
+        xEventGroupWaitBits(queue_event_group_, AS_QUEUE_DECODE_POPPED, pdTRUE, pdFALSE, pdMS_TO_TICKS(OPUS_FRAME_DURATION_MS));
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_PUSHED);
     return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
-        return nullptr;
+    auto packet = audio_send_queue_.Pop();
+    if (packet) {
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_SEND_POPPED);
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
     return packet;
 }
 
+std::unique_ptr<AudioStreamPacket> AudioService::AcquirePacket() {
+    return frame_pool_.AcquirePacket();
+}
+
+void AudioService::RecyclePacket(std::unique_ptr<AudioStreamPacket>&& packet) {
+    frame_pool_.Release(std::move(packet));
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
         wake_word_->EncodeWakeWordData();
@@ -445,10 +736,11 @@ const std::string& AudioService::GetLastWakeWord() const {
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
+    auto packet = frame_pool_.AcquirePacket();
     if (wake_word_->GetWakeWordOpus(packet->payload)) {
         return packet;
     }
+    frame_pool_.Release(std::move(packet));
     return nullptr;
 }
 
@@ -478,42 +770,87 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, encode_frame_duration_ms_, models_list_);
             audio_processor_initialized_ = true;
         }
+        audio_processor_->SetFrameDuration(encode_frame_duration_ms_);
 
         /* We should make sure no audio is playing */
         ResetDecoder();
         audio_input_need_warmup_ = true;
+        capture_clock_.Reset();
+        StartUplinkGate();
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
         audio_processor_->Stop();
+        uplink_gate_.Stop();
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     }
 }
 
+void AudioService::EnableUplinkGate(bool enable) {
+    uplink_gate_enabled_ = enable;
+}
+
+void AudioService::StartUplinkGate() {
+    /* The AFE only runs its VAD when device AEC is off; without it every frame would look silent */
+#if CONFIG_USE_AUDIO_PROCESSOR
+    uplink_gate_.Start(uplink_gate_enabled_ && !device_aec_enabled_);
+#else
+    uplink_gate_.Start(false);
+#endif
+}
+
+bool AudioService::EncoderDtx() {
+    return base_dtx_ || encoder_controller_.dtx() || uplink_gate_.dtx();
+}
+
+void AudioService::ApplyEncoderSettings() {
+    encoder_dtx_ = EncoderDtx();
+    opus_encoder_->SetComplexity(encoder_controller_.complexity());
+    opus_encoder_->SetDtx(encoder_dtx_);
+}
+
 void AudioService::EnableAudioTesting(bool enable) {
     ESP_LOGI(TAG, "%s audio testing", enable ? "Enabling" : "Disabling");
     if (enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* The opus task replays audio_testing_queue_ once the testing bit is cleared */
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_PUSHED);
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, encode_frame_duration_ms_, models_list_);
         audio_processor_initialized_ = true;
     }
 
     audio_processor_->EnableDeviceAec(enable);
+    device_aec_enabled_ = enable;
+    if (IsAudioProcessorRunning()) {
+        StartUplinkGate();
+    }
+}
+
+void AudioService::SetEncodeFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration: %d ms", frame_duration_ms);
+        return;
+    }
+    if (frame_duration_ms == encode_frame_duration_ms_) {
+        return;
+    }
+    ESP_LOGI(TAG, "Encode frame duration: %d ms", frame_duration_ms);
+    encode_frame_duration_ms_ = frame_duration_ms;
+    audio_send_queue_.SetLimit(2400 / frame_duration_ms);
+    if (IsAudioProcessorRunning()) {
+        ESP_LOGW(TAG, "Audio processor is running, the new frame duration applies from its next start");
+    }
 }
 
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
@@ -522,9 +859,19 @@ void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
 
 void AudioService::PlaySound(const std::string_view& ogg) {
     if (!codec_->output_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableOutput(true);
+        std::lock_guard<std::mutex> lock(codec_power_mutex_);
+        EnableCodecOutput(true);
+    }
+
+    /* Embedded sounds are indexed at build time, the decode task plays them from flash on the sound stream */
+    auto sound = FindEmbeddedSound(ogg);
+    if (sound != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(sound_mutex_);
+            pending_sounds_.push_back({sound, 0});
+        }
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_PUSHED);
+        return;
     }
 
     const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
@@ -607,11 +954,10 @@ void AudioService::PlaySound(const std::string_view& ogg) {
             }
 
             // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
+            auto packet = frame_pool_.AcquirePacket();
             packet->sample_rate = sample_rate;
             packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
+            packet->payload.assign(pkt_ptr, pkt_ptr + pkt_len);
             PushPacketToDecodeQueue(std::move(packet), true);
         }
 
@@ -619,34 +965,240 @@ void AudioService::PlaySound(const std::string_view& ogg) {
     }
 }
 
+bool AudioService::WriteMusicData(const int16_t* data, size_t samples, int sample_rate, int channels) {
+    if (channels <= 0 || sample_rate <= 0) {
+        return false;
+    }
+    size_t frames = samples / channels;
+    if (channels > 1) {
+        music_buffer_.resize(frames);
+        audio_downmix_s16(data, music_buffer_.data(), frames, channels);
+        data = music_buffer_.data();
+    }
+    if (music_resampler_.input_sample_rate() != sample_rate || music_resampler_.output_sample_rate() != codec_->output_sample_rate()) {
+        music_resampler_.Configure(sample_rate, codec_->output_sample_rate());
+    }
+
+    auto task = frame_pool_.AcquireTask(kAudioTaskTypeDecodeToPlaybackQueue);
+    task->pcm.resize(music_resampler_.GetOutputSamples(frames));
+    task->pcm.resize(music_resampler_.Process(data, frames, task->pcm.data()));
+
+    while (!music_playback_queue_.Push(std::move(task))) {
+        if (service_stopped_) {
+            frame_pool_.Release(std::move(task));
+            return false;
+        }
+        // The decode task waits on the same event, so poll instead of relying on a single wake-up
+        xEventGroupWaitBits(queue_event_group_, AS_QUEUE_PLAYBACK_POPPED, pdTRUE, pdFALSE, pdMS_TO_TICKS(MIN_OPUS_FRAME_DURATION_MS));
+    }
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_PUSHED);
+    return true;
+}
+
+void AudioService::ClearMusic() {
+    music_playback_queue_.Clear();
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_PUSHED);
+}
+
+void AudioService::SetStreamGain(AudioMixerStream stream, int32_t gain) {
+    mixer_.SetGain(stream, gain);
+}
+
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    {
+        std::lock_guard<std::mutex> lock(sound_mutex_);
+        if (!pending_sounds_.empty()) {
+            return false;
+        }
+    }
+    return audio_encode_queue_.Empty() && audio_jitter_buffer_.Empty() && audio_playback_queue_.Empty() && audio_testing_queue_.Empty() &&
+        sound_playback_queue_.Empty() && music_playback_queue_.Empty();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    /* Only the speech stream, UI sounds and music keep playing */
+    audio_jitter_buffer_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    /* Wake the consumers so they release the discarded slots */
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_PUSHED | AS_QUEUE_PLAYBACK_PUSHED);
 }
 
-void AudioService::CheckAndUpdateAudioPowerState() {
+void AudioService::SetLinkQuality(const AudioLinkQuality& quality) {
+    link_loss_percent_.store(quality.loss_percent, std::memory_order_relaxed);
+    link_jitter_ms_.store(quality.jitter_ms, std::memory_order_relaxed);
+}
+
+void AudioService::SetCodecPowerDemand(bool input, bool output) {
+    std::lock_guard<std::mutex> lock(codec_power_mutex_);
+    /* A direction released now gets the whole timeout from here, not from its last frame */
     auto now = std::chrono::steady_clock::now();
-    auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
-    auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
-    if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
-        codec_->EnableInput(false);
+    if (input_demanded_ && !input) {
+        last_input_time_ = now;
+    }
+    if (output_demanded_ && !output) {
+        last_output_time_ = now;
+    }
+    input_demanded_ = input;
+    output_demanded_ = output;
+    if (service_stopped_) {
+        return;
+    }
+
+    if (input) {
+        EnableCodecInput(true, true);
+    }
+    if (output) {
+        EnableCodecOutput(true, true);
     }
-    if (output_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->output_enabled()) {
-        codec_->EnableOutput(false);
+    if ((!input && codec_->input_enabled()) || (!output && codec_->output_enabled())) {
+        ScheduleAudioPowerCheck(AUDIO_POWER_TIMEOUT_MS);
+    }
+}
+
+/* The codec power helpers below are called with codec_power_mutex_ held */
+void AudioService::EnableCodecInput(bool enable, bool predicted) {
+    if (codec_->input_enabled() == enable) {
+        return;
+    }
+    int64_t start_time = esp_timer_get_time();
+    UpdateCodecPowerTime(start_time);
+    codec_->EnableInput(enable);
+    if (!enable) {
+        return;
+    }
+
+    uint32_t elapsed = esp_timer_get_time() - start_time;
+    debug_statistics_.codec_input_power_on_max_us = std::max(debug_statistics_.codec_input_power_on_max_us, elapsed);
+    if (predicted) {
+        debug_statistics_.codec_warm_starts++;
+    } else {
+        debug_statistics_.codec_cold_starts++;
+    }
+    last_input_time_ = std::chrono::steady_clock::now();
+    if (!input_demanded_) {
+        ScheduleAudioPowerCheck(AUDIO_POWER_TIMEOUT_MS);
+    }
+}
+
+void AudioService::EnableCodecOutput(bool enable, bool predicted) {
+    if (codec_->output_enabled() == enable) {
+        return;
+    }
+    int64_t start_time = esp_timer_get_time();
+    UpdateCodecPowerTime(start_time);
+    codec_->EnableOutput(enable);
+    if (!enable) {
+        return;
+    }
+
+    uint32_t elapsed = esp_timer_get_time() - start_time;
+    debug_statistics_.codec_output_power_on_max_us = std::max(debug_statistics_.codec_output_power_on_max_us, elapsed);
+    if (predicted) {
+        debug_statistics_.codec_warm_starts++;
+    } else {
+        debug_statistics_.codec_cold_starts++;
+    }
+    last_output_time_ = std::chrono::steady_clock::now();
+    if (!output_demanded_) {
+        ScheduleAudioPowerCheck(AUDIO_POWER_TIMEOUT_MS);
+    }
+}
+
+void AudioService::UpdateCodecPowerTime(int64_t now) {
+    uint64_t elapsed = now - codec_power_changed_us_;
+    codec_power_changed_us_ = now;
+    if (codec_->input_enabled()) {
+        codec_input_on_us_ += elapsed;
+    }
+    if (codec_->output_enabled()) {
+        codec_output_on_us_ += elapsed;
     }
     if (!codec_->input_enabled() && !codec_->output_enabled()) {
-        esp_timer_stop(audio_power_timer_);
+        codec_off_us_ += elapsed;
+    }
+}
+
+/* The timer is one-shot and only ever brought forward, activity moves the deadline and the check re-arms itself */
+void AudioService::ScheduleAudioPowerCheck(int64_t delay_ms) {
+    int64_t due_us = esp_timer_get_time() + delay_ms * 1000;
+    if (audio_power_check_us_ != 0 && audio_power_check_us_ <= due_us) {
+        return;
+    }
+    esp_timer_stop(audio_power_timer_);
+    esp_timer_start_once(audio_power_timer_, delay_ms * 1000);
+    audio_power_check_us_ = due_us;
+}
+
+void AudioService::CheckAndUpdateAudioPowerState() {
+    std::lock_guard<std::mutex> lock(codec_power_mutex_);
+    audio_power_check_us_ = 0;
+    if (service_stopped_) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    int64_t next_check_ms = 0;
+    if (codec_->input_enabled() && !input_demanded_) {
+        auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
+        if (input_elapsed >= AUDIO_POWER_TIMEOUT_MS) {
+            EnableCodecInput(false);
+        } else {
+            next_check_ms = AUDIO_POWER_TIMEOUT_MS - input_elapsed;
+        }
+    }
+    if (codec_->output_enabled() && !output_demanded_) {
+        auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
+        if (output_elapsed >= AUDIO_POWER_TIMEOUT_MS) {
+            EnableCodecOutput(false);
+        } else if (next_check_ms == 0 || AUDIO_POWER_TIMEOUT_MS - output_elapsed < next_check_ms) {
+            next_check_ms = AUDIO_POWER_TIMEOUT_MS - output_elapsed;
+        }
+    }
+    if (next_check_ms > 0) {
+        ScheduleAudioPowerCheck(next_check_ms);
+    }
+}
+
+DebugStatistics AudioService::GetDebugStatistics() {
+    DebugStatistics statistics = debug_statistics_;
+    statistics.pool_alloc_count = frame_pool_.alloc_count();
+#if CONFIG_AUDIO_HEAP_ALLOC_TRACKING
+    statistics.heap_alloc_count = audio_task_heap_allocs.load(std::memory_order_relaxed);
+#endif
+    auto jitter = audio_jitter_buffer_.GetStatistics();
+    statistics.late_packet_count = jitter.late_count;
+    statistics.lost_packet_count = jitter.lost_count;
+    statistics.jitter_ms = jitter.jitter_ms;
+    statistics.jitter_depth = jitter.target_depth;
+    statistics.decode_queue_high_water = jitter.high_water_mark;
+    statistics.encode_queue_high_water = audio_encode_queue_.HighWaterMark();
+    statistics.send_queue_high_water = audio_send_queue_.HighWaterMark();
+    statistics.playback_queue_high_water = audio_playback_queue_.HighWaterMark();
+    statistics.encoder_complexity = encoder_controller_.complexity();
+    statistics.encoder_dtx = encoder_dtx_;
+    statistics.link_loss_percent = link_loss_percent_.load(std::memory_order_relaxed);
+    statistics.link_jitter_ms = link_jitter_ms_.load(std::memory_order_relaxed);
+    auto uplink = uplink_gate_.GetStatistics();
+    statistics.uplink_sent_bytes = uplink.sent_bytes;
+    statistics.uplink_suppressed_frames = uplink.suppressed_frames;
+    statistics.uplink_suppressed_bytes = uplink.suppressed_bytes;
+    if (audio_processor_) {
+        auto processor = audio_processor_->GetStatistics();
+        statistics.processor_latency_ms = processor.fetch_latency_ms;
+        statistics.processor_latency_max_ms = processor.fetch_latency_max_ms;
+        statistics.processor_ring_samples = processor.ring_samples;
+        statistics.processor_ring_high_water = processor.ring_high_water;
+    }
+    {
+        std::lock_guard<std::mutex> lock(codec_power_mutex_);
+        UpdateCodecPowerTime(esp_timer_get_time());
+        statistics.codec_input_on_ms = codec_input_on_us_ / 1000;
+        statistics.codec_output_on_ms = codec_output_on_us_ / 1000;
+        statistics.codec_off_ms = codec_off_us_ / 1000;
     }
+    return statistics;
 }
 
 void AudioService::SetModelsList(srmodel_list_t* models_list) {
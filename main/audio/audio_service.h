@@ -3,9 +3,9 @@
 
 #include <memory>
 #include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -15,10 +15,19 @@
 
 #include <opus_encoder.h>
 #include <opus_decoder.h>
-#include <opus_resampler.h>
 
 #include "audio_codec.h"
 #include "audio_processor.h"
+#include "audio_ring_queue.h"
+#include "audio_frame_pool.h"
+#include "audio_jitter_buffer.h"
+#include "audio_latency_tracer.h"
+#include "audio_playback_clock.h"
+#include "audio_encoder_controller.h"
+#include "audio_sound_cache.h"
+#include "audio_mixer.h"
+#include "audio_resampler.h"
+#include "audio_uplink_gate.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
@@ -27,24 +36,40 @@
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Jitter Buffer} -> [Opus Decoder] -> {Playback Queue} -> [Mixer] -> (Speaker)
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * The mixer also takes the UI sounds, decoded by the Opus decode task into their own queue, and the
+ * music written by WriteMusicData(), so an alert neither flushes nor waits for speech or music.
+ *
+ * We use one task for MIC / Speaker / Processors, and separate tasks for the Opus Encoder and the Opus Decoder
+ * so both directions can run in parallel, each on its own core where the chip has two.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
+ *
+ * Every queue is a bounded single-producer / single-consumer ring with its own wake events, so a push
+ * or pop only wakes the task that is actually waiting on that queue. The decode side is a jitter buffer
+ * instead, which reorders packets by sequence and lets the decoder conceal the lost ones.
  * 
  */
 
 #define OPUS_FRAME_DURATION_MS 60
+#define MIN_OPUS_FRAME_DURATION_MS 20
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
+// Music frames are short (an MP3 frame is 24-26 ms) and must cover a whole speech frame when mixed
+#define MAX_MUSIC_TASKS_IN_QUEUE 8
 #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+// The send queue holds 2400 ms whatever the negotiated frame duration, see SetEncodeFrameDuration()
+#define MAX_SEND_PACKETS_IN_QUEUE (2400 / MIN_OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
-#define MAX_TIMESTAMPS_IN_QUEUE 3
+#define AUDIO_PACKET_MAX_BITRATE 64000
 
+// A codec direction no device state asks for powers down after this long unused
 #define AUDIO_POWER_TIMEOUT_MS 15000
-#define AUDIO_POWER_CHECK_INTERVAL_MS 1000
+
+// Input RMS (about -30 dBFS) that counts as activity while waiting for the wake word, and how often it is reported
+#define AUDIO_ACTIVITY_THRESHOLD 1000
+#define AUDIO_ACTIVITY_INTERVAL_MS 10000
 
 
 #define AS_EVENT_AUDIO_TESTING_RUNNING      (1 << 0)
@@ -52,31 +77,73 @@
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
 
+#define AS_QUEUE_ENCODE_PUSHED              (1 << 0)
+#define AS_QUEUE_ENCODE_POPPED              (1 << 1)
+#define AS_QUEUE_DECODE_PUSHED              (1 << 2)
+#define AS_QUEUE_DECODE_POPPED              (1 << 3)
+#define AS_QUEUE_SEND_POPPED                (1 << 4)
+#define AS_QUEUE_PLAYBACK_PUSHED            (1 << 5)
+#define AS_QUEUE_PLAYBACK_POPPED            (1 << 6)
+#define AS_QUEUE_ALL_EVENTS                 (0x7F)
+
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
     std::function<void(bool)> on_vad_change;
+    // Sound above AUDIO_ACTIVITY_THRESHOLD while waiting for the wake word, at most every AUDIO_ACTIVITY_INTERVAL_MS
+    std::function<void(void)> on_audio_activity;
     std::function<void(void)> on_audio_testing_queue_full;
 };
 
 
-enum AudioTaskType {
-    kAudioTaskTypeEncodeToSendQueue,
-    kAudioTaskTypeEncodeToTestingQueue,
-    kAudioTaskTypeDecodeToPlaybackQueue,
-};
-
-struct AudioTask {
-    AudioTaskType type;
-    std::vector<int16_t> pcm;
-    uint32_t timestamp;
-};
-
 struct DebugStatistics {
     uint32_t input_count = 0;
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    // Packets and tasks the frame pool had to allocate because none was free
+    uint32_t pool_alloc_count = 0;
+    // Every malloc on the audio tasks, only counted with CONFIG_AUDIO_HEAP_ALLOC_TRACKING
+    uint32_t heap_alloc_count = 0;
+    uint32_t late_packet_count = 0;
+    uint32_t lost_packet_count = 0;
+    uint32_t concealed_frame_count = 0;
+    uint32_t jitter_ms = 0;
+    uint32_t jitter_depth = 0;
+    // Time spent per frame in the Opus workers, the average is total / count
+    uint64_t encode_time_total_us = 0;
+    uint32_t encode_time_max_us = 0;
+    uint64_t decode_time_total_us = 0;
+    uint32_t decode_time_max_us = 0;
+    // Highest occupancy of each queue
+    uint32_t encode_queue_high_water = 0;
+    uint32_t send_queue_high_water = 0;
+    uint32_t decode_queue_high_water = 0;
+    uint32_t playback_queue_high_water = 0;
+    // Current uplink encoder settings chosen by AudioEncoderController
+    int encoder_complexity = 0;
+    bool encoder_dtx = false;
+    // Uplink frames sent and held back as silence by AudioUplinkGate in the current listening session
+    uint32_t uplink_sent_bytes = 0;
+    uint32_t uplink_suppressed_frames = 0;
+    uint32_t uplink_suppressed_bytes = 0;
+    // Delay through the audio processor and the occupancy of its output ring, see AudioProcessorStatistics
+    uint32_t processor_latency_ms = 0;
+    uint32_t processor_latency_max_ms = 0;
+    uint32_t processor_ring_samples = 0;
+    uint32_t processor_ring_high_water = 0;
+    // Codec power-ups paid by the first frame of a read or write, and those made ahead of it on a device
+    // state change; the slowest power-up of each direction and the time spent powered, see SetCodecPowerDemand()
+    uint32_t codec_cold_starts = 0;
+    uint32_t codec_warm_starts = 0;
+    uint32_t codec_input_power_on_max_us = 0;
+    uint32_t codec_output_power_on_max_us = 0;
+    uint32_t codec_input_on_ms = 0;
+    uint32_t codec_output_on_ms = 0;
+    uint32_t codec_off_ms = 0;
+    // Last downlink quality reported by the transport, see SetLinkQuality()
+    uint32_t link_loss_percent = 0;
+    uint32_t link_jitter_ms = 0;
 };
 
 class AudioService {
@@ -100,15 +167,32 @@ public:
     void EnableVoiceProcessing(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    // Lets the uplink gate act on the VAD in the next listening session (manual stop and realtime modes)
+    void EnableUplinkGate(bool enable);
+    // Uplink frame duration negotiated for the session (20, 40 or 60 ms)
+    void SetEncodeFrameDuration(int frame_duration_ms);
+    // Codec directions the current device state is about to use: these power up now and stay up, the
+    // others power down once unused for AUDIO_POWER_TIMEOUT_MS
+    void SetCodecPowerDemand(bool input, bool output);
+    // Downlink quality of the session transport; a lossy link makes the uplink encoder back off like congestion does
+    void SetLinkQuality(const AudioLinkQuality& quality);
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    std::unique_ptr<AudioStreamPacket> AcquirePacket();
+    void RecyclePacket(std::unique_ptr<AudioStreamPacket>&& packet);
     void PlaySound(const std::string_view& sound);
+    // Music task: plays interleaved PCM at any rate, blocking while the music queue is full
+    bool WriteMusicData(const int16_t* data, size_t samples, int sample_rate, int channels);
+    void ClearMusic();
+    // Q16 gain of a playback stream, at most unity
+    void SetStreamGain(AudioMixerStream stream, int32_t gain);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
+    DebugStatistics GetDebugStatistics();
 
 private:
     AudioCodec* codec_ = nullptr;
@@ -118,44 +202,101 @@ private:
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
-    OpusResampler input_resampler_;
-    OpusResampler reference_resampler_;
-    OpusResampler output_resampler_;
+    AudioResampler input_resampler_;
+    AudioResampler reference_resampler_;
+    AudioResampler output_resampler_;
     DebugStatistics debug_statistics_;
+    AudioFramePool frame_pool_;
+    AudioMixer mixer_{frame_pool_};
+    AudioEncoderController encoder_controller_;
+    AudioUplinkGate uplink_gate_;
+    AudioCaptureClock capture_clock_;
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
+    EventGroupHandle_t queue_event_group_;
 
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    TaskHandle_t opus_decode_task_handle_ = nullptr;
+    TaskHandle_t opus_encode_task_handle_ = nullptr;
+    AudioJitterBuffer audio_jitter_buffer_{MAX_DECODE_PACKETS_IN_QUEUE};
+    AudioRingQueue<AudioStreamPacket> audio_send_queue_{MAX_SEND_PACKETS_IN_QUEUE};
+    AudioRingQueue<AudioStreamPacket> audio_testing_queue_{AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS + MAX_ENCODE_TASKS_IN_QUEUE};
+    AudioRingQueue<AudioTask> audio_encode_queue_{MAX_ENCODE_TASKS_IN_QUEUE};
+    AudioRingQueue<AudioTask> audio_playback_queue_{MAX_PLAYBACK_TASKS_IN_QUEUE};
+    AudioRingQueue<AudioTask> sound_playback_queue_{MAX_PLAYBACK_TASKS_IN_QUEUE};
+    AudioRingQueue<AudioTask> music_playback_queue_{MAX_MUSIC_TASKS_IN_QUEUE};
+    // Embedded sounds in play order, decoded by the decode task with a decoder of their own
+    struct PendingSound {
+        const OggSoundIndex* sound;
+        size_t next_packet;
+    };
+    std::mutex sound_mutex_;
+    std::deque<PendingSound> pending_sounds_;
+    std::unique_ptr<OpusDecoderWrapper> sound_decoder_;
+    AudioResampler sound_resampler_;
+    AudioSoundPcmCache sound_pcm_cache_;
+    AudioResampler music_resampler_;
     // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    AudioPlaybackClock playback_clock_;
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
+    std::atomic<uint32_t> link_loss_percent_{0};
+    std::atomic<uint32_t> link_jitter_ms_{0};
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    bool uplink_gate_enabled_ = false;
+    bool device_aec_enabled_ = false;
+    // DTX is on by default, as the encoder wrapper creates it; the controller and the uplink gate only add it
+    bool base_dtx_ = true;
+    bool encoder_dtx_ = true;
+    int encode_frame_duration_ms_ = OPUS_FRAME_DURATION_MS;
+
+    // Scratch buffers reused on every frame, owned by the task noted
+    std::vector<int16_t> input_buffer_;                 // AudioInputTask
+    std::vector<int16_t> input_channel_buffer_;         // ReadAudioData
+    std::vector<int16_t> reference_channel_buffer_;     // ReadAudioData
+    std::vector<int16_t> resampled_input_buffer_;       // ReadAudioData
+    std::vector<int16_t> resampled_reference_buffer_;   // ReadAudioData
+    std::vector<int16_t> output_resample_buffer_;       // OpusDecodeTask
+    std::vector<int16_t> music_buffer_;                 // WriteMusicData
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
     std::chrono::steady_clock::time_point last_output_time_;
+    std::mutex codec_power_mutex_;
+    bool input_demanded_ = false;
+    bool output_demanded_ = false;
+    int64_t codec_power_changed_us_ = 0;
+    int64_t audio_power_check_us_ = 0;
+    int64_t last_activity_time_us_ = 0;
+    uint64_t codec_input_on_us_ = 0;
+    uint64_t codec_output_on_us_ = 0;
+    uint64_t codec_off_us_ = 0;
 
     void AudioInputTask();
     void AudioOutputTask();
-    void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void OpusDecodeTask();
+    void OpusEncodeTask();
+    bool HasPendingSound();
+    void DecodeSoundFrame();
+    void PushTaskToEncodeQueue(AudioTaskType type, const std::vector<int16_t>& pcm, int64_t capture_time_us);
+    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm, int64_t capture_time_us);
+    void PushTaskToEncodeQueue(std::unique_ptr<AudioTask>&& task, int64_t capture_time_us);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    bool EncoderDtx();
+    void ApplyEncoderSettings();
+    void StartUplinkGate();
     void CheckAndUpdateAudioPowerState();
+    void CheckAudioActivity(const std::vector<int16_t>& data);
+    void EnableCodecInput(bool enable, bool predicted = false);
+    void EnableCodecOutput(bool enable, bool predicted = false);
+    void UpdateCodecPowerTime(int64_t now);
+    void ScheduleAudioPowerCheck(int64_t delay_ms);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "audio_sound_cache.h"
+#include "assets/sound_index.h"
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+#include <cstring>
+
+#if CONFIG_USE_SOUND_PCM_CACHE
+#include <esp_heap_caps.h>
+#endif
+
+#define TAG "AudioSoundCache"
+
+const OggSoundIndex* FindEmbeddedSound(const std::string_view& ogg) {
+    for (auto sound = kEmbeddedSounds; sound->data != nullptr; sound++) {
+        if (sound->data == ogg.data() && sound->size == ogg.size()) {
+            return sound;
+        }
+    }
+    return nullptr;
+}
+
+AudioSoundPcmCache::~AudioSoundPcmCache() {
+#if CONFIG_USE_SOUND_PCM_CACHE
+    for (auto& entry : entries_) {
+        heap_caps_free(entry.pcm);
+    }
+#endif
+}
+
+AudioSoundPcmCache::Entry* AudioSoundPcmCache::Find(const OggSoundIndex* sound) {
+    for (auto& entry : entries_) {
+        if (entry.sound == sound) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool AudioSoundPcmCache::Lookup(const OggSoundIndex* sound, size_t packet, std::vector<int16_t>& pcm) {
+    auto entry = Find(sound);
+    if (entry == nullptr || entry->pcm == nullptr || entry->filled < sound->packet_count) {
+        return false;
+    }
+    const int16_t* frame = entry->pcm + packet * entry->frame_samples;
+    pcm.assign(frame, frame + entry->frame_samples);
+    return true;
+}
+
+void AudioSoundPcmCache::Store(const OggSoundIndex* sound, size_t packet, const std::vector<int16_t>& pcm) {
+#if CONFIG_USE_SOUND_PCM_CACHE
+    auto entry = Find(sound);
+    if (entry == nullptr) {
+        if (packet != 0) {
+            return;
+        }
+        size_t bytes = sound->packet_count * pcm.size() * sizeof(int16_t);
+        int16_t* buffer = nullptr;
+        if (bytes <= SOUND_PCM_CACHE_MAX_SOUND_BYTES && total_bytes_ + bytes <= SOUND_PCM_CACHE_MAX_BYTES) {
+            buffer = (int16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+        }
+        if (buffer != nullptr) {
+            total_bytes_ += bytes;
+            ESP_LOGI(TAG, "Caching %u packets (%u bytes) of PCM, %u bytes in use", (unsigned)sound->packet_count,
+                (unsigned)bytes, (unsigned)total_bytes_);
+        }
+        entries_.push_back({sound, buffer, pcm.size(), 0});
+        entry = &entries_.back();
+    }
+    if (entry->pcm == nullptr || entry->filled == sound->packet_count) {
+        return;
+    }
+
+    // Start over whenever the sound restarts, or a frame was skipped or has another size
+    if (packet == 0) {
+        entry->filled = 0;
+    }
+    if (packet != entry->filled || pcm.size() != entry->frame_samples) {
+        entry->filled = 0;
+        return;
+    }
+    memcpy(entry->pcm + packet * entry->frame_samples, pcm.data(), entry->frame_samples * sizeof(int16_t));
+    entry->filled++;
+#endif
+}
@@ -0,0 +1,64 @@
+#ifndef AUDIO_SOUND_CACHE_H
+#define AUDIO_SOUND_CACHE_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// PCM budget per cached sound and for all of them
+#define SOUND_PCM_CACHE_MAX_SOUND_BYTES (96 * 1024)
+#define SOUND_PCM_CACHE_MAX_BYTES (256 * 1024)
+
+// Location of one Opus packet inside an embedded OGG file
+struct OggPacketRef {
+    uint32_t offset;
+    uint16_t size;
+};
+
+// Packet table of an embedded OGG file, generated at build time by scripts/gen_sound_index.py
+struct OggSoundIndex {
+    const char* data;
+    size_t size;
+    int sample_rate;
+    size_t packet_count;
+    const OggPacketRef* packets;
+};
+
+// Returns the packet table of a sound embedded in the firmware, or nullptr for any other buffer
+const OggSoundIndex* FindEmbeddedSound(const std::string_view& ogg);
+
+/*
+ * Decoded frames of short embedded sounds, kept in PSRAM with CONFIG_USE_SOUND_PCM_CACHE.
+ *
+ * A sound is cached the first time it is decoded from its first packet to its last, at the rate
+ * the decode task hands to the speaker; after that its frames are copied instead of decoded.
+ * Only the Opus decode task uses it.
+ */
+class AudioSoundPcmCache {
+public:
+    AudioSoundPcmCache() = default;
+    ~AudioSoundPcmCache();
+
+    AudioSoundPcmCache(const AudioSoundPcmCache&) = delete;
+    AudioSoundPcmCache& operator=(const AudioSoundPcmCache&) = delete;
+
+    // Fills pcm with the frame of the given packet if the whole sound is cached
+    bool Lookup(const OggSoundIndex* sound, size_t packet, std::vector<int16_t>& pcm);
+    // Offers a decoded frame, it is only kept when the frames of the sound arrive in order
+    void Store(const OggSoundIndex* sound, size_t packet, const std::vector<int16_t>& pcm);
+
+private:
+    struct Entry {
+        const OggSoundIndex* sound;
+        int16_t* pcm;           // nullptr if the sound does not fit in the cache
+        size_t frame_samples;
+        size_t filled;
+    };
+    std::vector<Entry> entries_;
+    size_t total_bytes_ = 0;
+
+    Entry* Find(const OggSoundIndex* sound);
+};
+
+#endif // AUDIO_SOUND_CACHE_H
@@ -0,0 +1,113 @@
+#include "audio_uplink_gate.h"
+
+#include <esp_log.h>
+
+#define TAG "AudioUplinkGate"
+
+AudioUplinkGate::AudioUplinkGate() {
+    held_.reserve(AUDIO_UPLINK_PREROLL_MS / AUDIO_UPLINK_MIN_FRAME_MS + 1);
+}
+
+void AudioUplinkGate::OnSend(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback) {
+    send_callback_ = callback;
+}
+
+void AudioUplinkGate::OnDrop(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback) {
+    drop_callback_ = callback;
+}
+
+void AudioUplinkGate::SetMode(AudioUplinkGateMode mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mode_ = mode;
+}
+
+void AudioUplinkGate::Start(bool active) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DropHeld();
+    active_ = active && mode_ != kUplinkGateOff;
+    hangover_ms_ = 0;
+    since_sent_ms_ = 0;
+    statistics_ = AudioUplinkGateStatistics();
+}
+
+void AudioUplinkGate::Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The pre-roll still held is counted as suppressed before the summary
+    DropHeld();
+    if (active_ && mode_ == kUplinkGateSuppress) {
+        uint32_t total = statistics_.sent_bytes + statistics_.suppressed_bytes;
+        ESP_LOGI(TAG, "Suppressed %lu of %lu frames, %lu of %lu bytes",
+            (unsigned long)statistics_.suppressed_frames,
+            (unsigned long)(statistics_.sent_frames + statistics_.suppressed_frames),
+            (unsigned long)statistics_.suppressed_bytes, (unsigned long)total);
+    }
+    active_ = false;
+}
+
+bool AudioUplinkGate::dtx() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_ && mode_ != kUplinkGateOff;
+}
+
+AudioUplinkGateStatistics AudioUplinkGate::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+void AudioUplinkGate::Push(std::unique_ptr<AudioStreamPacket>&& packet, bool voice) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int duration = packet->frame_duration;
+    if (!active_ || mode_ != kUplinkGateSuppress) {
+        Send(std::move(packet));
+        return;
+    }
+
+    if (voice) {
+        hangover_ms_ = AUDIO_UPLINK_HANGOVER_MS;
+    }
+    if (hangover_ms_ > 0) {
+        hangover_ms_ -= duration;
+        for (auto& held : held_) {
+            Send(std::move(held));
+        }
+        held_.clear();
+        held_ms_ = 0;
+        Send(std::move(packet));
+        return;
+    }
+
+    held_.push_back(std::move(packet));
+    held_ms_ += duration;
+    since_sent_ms_ += duration;
+    while (held_ms_ > AUDIO_UPLINK_PREROLL_MS || held_.size() > AUDIO_UPLINK_PREROLL_MS / AUDIO_UPLINK_MIN_FRAME_MS) {
+        auto oldest = std::move(held_.front());
+        held_.erase(held_.begin());
+        held_ms_ -= oldest->frame_duration;
+        if (since_sent_ms_ >= AUDIO_UPLINK_SILENCE_INTERVAL_MS) {
+            Send(std::move(oldest));
+        } else {
+            Drop(std::move(oldest));
+        }
+    }
+}
+
+void AudioUplinkGate::Send(std::unique_ptr<AudioStreamPacket>&& packet) {
+    statistics_.sent_frames++;
+    statistics_.sent_bytes += packet->payload.size();
+    since_sent_ms_ = 0;
+    send_callback_(std::move(packet));
+}
+
+void AudioUplinkGate::Drop(std::unique_ptr<AudioStreamPacket>&& packet) {
+    statistics_.suppressed_frames++;
+    statistics_.suppressed_bytes += packet->payload.size();
+    drop_callback_(std::move(packet));
+}
+
+void AudioUplinkGate::DropHeld() {
+    for (auto& held : held_) {
+        Drop(std::move(held));
+    }
+    held_.clear();
+    held_ms_ = 0;
+}
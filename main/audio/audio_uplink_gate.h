@@ -0,0 +1,86 @@
+#ifndef AUDIO_UPLINK_GATE_H
+#define AUDIO_UPLINK_GATE_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "protocol.h"
+
+// Frames still sent after the VAD reports silence, so word endings and short pauses are not cut
+#define AUDIO_UPLINK_HANGOVER_MS 400
+// Frames held back during silence and sent ahead of the first speech frame, covering the VAD's onset delay
+#define AUDIO_UPLINK_PREROLL_MS 300
+// During silence one frame per interval still goes out, carrying Opus's comfort noise updates and
+// keeping the stream alive for the server
+#define AUDIO_UPLINK_SILENCE_INTERVAL_MS 400
+#define AUDIO_UPLINK_MIN_FRAME_MS 20
+
+enum AudioUplinkGateMode {
+    kUplinkGateOff,         // Every frame is sent, with the encoder's default DTX
+    kUplinkGateSuppress,    // Opus DTX, and silent frames are held back
+};
+
+struct AudioUplinkGateStatistics {
+    uint32_t sent_frames = 0;
+    uint32_t sent_bytes = 0;
+    uint32_t suppressed_frames = 0;
+    uint32_t suppressed_bytes = 0;
+};
+
+/*
+ * Decides which encoded uplink frames are sent, from the VAD state of the audio they carry.
+ *
+ * While the gate is open (speech, then the hangover) frames pass straight through. Once it closes,
+ * frames are kept in a pre-roll of AUDIO_UPLINK_PREROLL_MS; the oldest one leaving it is sent if
+ * AUDIO_UPLINK_SILENCE_INTERVAL_MS passed since the last sent frame, and dropped otherwise. When speech
+ * starts again the pre-roll is sent first, so the server always receives frames in order.
+ *
+ * Only applies between Start() and Stop(), and only in the modes where the VAD output is trusted.
+ * Push() is called by the Opus encode task, the rest from any task.
+ */
+class AudioUplinkGate {
+public:
+    AudioUplinkGate();
+
+    AudioUplinkGate(const AudioUplinkGate&) = delete;
+    AudioUplinkGate& operator=(const AudioUplinkGate&) = delete;
+
+    // Receives the frames to send, and the frames dropped so their buffers can be recycled
+    void OnSend(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback);
+    void OnDrop(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback);
+
+    void SetMode(AudioUplinkGateMode mode);
+    inline AudioUplinkGateMode mode() const { return mode_; }
+
+    // Starts a session, with the gate applied or not; resets the statistics
+    void Start(bool active);
+    // Ends the session, dropping the frames still held back
+    void Stop();
+    // Whether the encoder has to run with DTX
+    bool dtx();
+
+    void Push(std::unique_ptr<AudioStreamPacket>&& packet, bool voice);
+    AudioUplinkGateStatistics GetStatistics();
+
+private:
+    std::mutex mutex_;
+    AudioUplinkGateMode mode_ = kUplinkGateOff;
+    bool active_ = false;
+    int hangover_ms_ = 0;
+    int since_sent_ms_ = 0;
+    int held_ms_ = 0;
+    std::vector<std::unique_ptr<AudioStreamPacket>> held_;
+    AudioUplinkGateStatistics statistics_;
+    std::function<void(std::unique_ptr<AudioStreamPacket>&&)> send_callback_;
+    std::function<void(std::unique_ptr<AudioStreamPacket>&&)> drop_callback_;
+
+    void Send(std::unique_ptr<AudioStreamPacket>&& packet);
+    void Drop(std::unique_ptr<AudioStreamPacket>&& packet);
+    void DropHeld();
+};
+
+#endif // AUDIO_UPLINK_GATE_H
@@ -1,5 +1,7 @@
 #include "afe_audio_processor.h"
 #include <esp_log.h>
+#include <algorithm>
+#include <cstring>
 
 #define PROCESSOR_RUNNING 0x01
 
@@ -12,10 +14,8 @@ AfeAudioProcessor::AfeAudioProcessor()
 
 void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
-    frame_samples_ = frame_duration_ms * 16000 / 1000;
-
-    // Pre-allocate output buffer capacity
-    output_buffer_.reserve(frame_samples_);
+    SetFrameDuration(frame_duration_ms);
+    frame_.reserve(frame_samples_);
 
     int ref_num = codec_->input_reference() ? 1 : 0;
 
@@ -93,17 +93,26 @@ void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
         return;
     }
     afe_iface_->feed(afe_data_, data.data());
+    fed_samples_ += data.size() / codec_->input_channels();
 }
 
 void AfeAudioProcessor::Start() {
     xEventGroupSetBits(event_group_, PROCESSOR_RUNNING);
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    // Picked up by the processor task on its next fetch
+    frame_samples_ = std::min(frame_duration_ms, AFE_OUTPUT_MAX_FRAME_MS) * 16000 / 1000;
+}
+
 void AfeAudioProcessor::Stop() {
     xEventGroupClearBits(event_group_, PROCESSOR_RUNNING);
     if (afe_data_ != nullptr) {
         afe_iface_->reset_buffer(afe_data_);
     }
+    // Samples left in the ring belong to the old session, the processor task drops them
+    fed_samples_ = 0;
+    ring_reset_ = true;
 }
 
 bool AfeAudioProcessor::IsRunning() {
@@ -118,14 +127,51 @@ void AfeAudioProcessor::OnVadStateChange(std::function<void(bool speaking)> call
     vad_state_change_callback_ = callback;
 }
 
+void AfeAudioProcessor::PushToRing(const int16_t* data, size_t samples) {
+    size_t capacity = ring_.size();
+    if (samples > capacity - ring_samples_) {
+        // Cannot happen while frames fit AFE_OUTPUT_MAX_FRAME_MS, keep the newest audio anyway
+        size_t overflow = std::min(samples - (capacity - ring_samples_), ring_samples_);
+        ESP_LOGW(TAG, "Output ring overflow, dropping %u samples", (unsigned)overflow);
+        ring_read_ = (ring_read_ + overflow) % capacity;
+        ring_samples_ -= overflow;
+        if (samples > capacity) {
+            data += samples - capacity;
+            samples = capacity;
+        }
+    }
+    size_t write = (ring_read_ + ring_samples_) % capacity;
+    size_t first = std::min(samples, capacity - write);
+    memcpy(&ring_[write], data, first * sizeof(int16_t));
+    memcpy(&ring_[0], data + first, (samples - first) * sizeof(int16_t));
+    ring_samples_ += samples;
+}
+
+void AfeAudioProcessor::PopFromRing(int16_t* data, size_t samples) {
+    size_t capacity = ring_.size();
+    size_t first = std::min(samples, capacity - ring_read_);
+    memcpy(data, &ring_[ring_read_], first * sizeof(int16_t));
+    memcpy(data + first, &ring_[0], (samples - first) * sizeof(int16_t));
+    ring_read_ = (ring_read_ + samples) % capacity;
+    ring_samples_ -= samples;
+}
+
 void AfeAudioProcessor::AudioProcessorTask() {
     auto fetch_size = afe_iface_->get_fetch_chunksize(afe_data_);
     auto feed_size = afe_iface_->get_feed_chunksize(afe_data_);
     ESP_LOGI(TAG, "Audio communication task started, feed size: %d fetch size: %d",
         feed_size, fetch_size);
 
+    // Room for one fetch on top of the longest frame, allocated once
+    ring_.assign(fetch_size + AFE_OUTPUT_MAX_FRAME_MS * 16000 / 1000, 0);
+
     while (true) {
         xEventGroupWaitBits(event_group_, PROCESSOR_RUNNING, pdFALSE, pdTRUE, portMAX_DELAY);
+        if (ring_reset_.exchange(false)) {
+            ring_read_ = 0;
+            ring_samples_ = 0;
+            fetched_samples_ = 0;
+        }
 
         auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
         if ((xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING) == 0) {
@@ -149,26 +195,31 @@ void AfeAudioProcessor::AudioProcessorTask() {
             }
         }
 
+        size_t samples = res->data_size / sizeof(int16_t);
+        fetched_samples_ += samples;
+        uint32_t fed = fed_samples_;
+        uint32_t latency_ms = fed > fetched_samples_ ? (fed - fetched_samples_) * 1000 / 16000 : 0;
+
+        uint32_t ring_peak = 0;
         if (output_callback_) {
-            size_t samples = res->data_size / sizeof(int16_t);
-            
-            // Add data to buffer
-            output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
-            
-            // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
+            PushToRing(res->data, samples);
+            ring_peak = ring_samples_;
+
+            // Output complete frames when the ring has enough data
+            size_t frame_samples = frame_samples_;
+            while (ring_samples_ >= frame_samples) {
+                frame_.resize(frame_samples);
+                PopFromRing(frame_.data(), frame_samples);
+                output_callback_(std::move(frame_));
             }
         }
+
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.fetch_count++;
+        statistics_.fetch_latency_ms = latency_ms;
+        statistics_.fetch_latency_max_ms = std::max(statistics_.fetch_latency_max_ms, latency_ms);
+        statistics_.ring_samples = ring_samples_;
+        statistics_.ring_high_water = std::max<uint32_t>(statistics_.ring_high_water, ring_peak);
     }
 }
 
@@ -185,3 +236,8 @@ void AfeAudioProcessor::EnableDeviceAec(bool enable) {
         afe_iface_->enable_vad(afe_data_);
     }
 }
+
+AudioProcessorStatistics AfeAudioProcessor::GetStatistics() {
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    return statistics_;
+}
@@ -6,6 +6,8 @@
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <functional>
@@ -13,12 +15,16 @@
 #include "audio_processor.h"
 #include "audio_codec.h"
 
+// Longest frame SetFrameDuration() accepts, sizes the output ring
+#define AFE_OUTPUT_MAX_FRAME_MS 120
+
 class AfeAudioProcessor : public AudioProcessor {
 public:
     AfeAudioProcessor();
     ~AfeAudioProcessor();
 
     void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
+    void SetFrameDuration(int frame_duration_ms) override;
     void Feed(std::vector<int16_t>&& data) override;
     void Start() override;
     void Stop() override;
@@ -27,6 +33,7 @@ public:
     void OnVadStateChange(std::function<void(bool speaking)> callback) override;
     size_t GetFeedSize() override;
     void EnableDeviceAec(bool enable) override;
+    AudioProcessorStatistics GetStatistics() override;
 
 private:
     EventGroupHandle_t event_group_ = nullptr;
@@ -35,11 +42,24 @@ private:
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    std::atomic<size_t> frame_samples_{0};
     bool is_speaking_ = false;
-    std::vector<int16_t> output_buffer_;
+
+    // Fetched samples are framed in a fixed ring owned by the processor task, frames go out in frame_
+    std::vector<int16_t> ring_;
+    size_t ring_read_ = 0;
+    size_t ring_samples_ = 0;
+    std::atomic<bool> ring_reset_{false};
+    std::vector<int16_t> frame_;
+
+    std::atomic<uint32_t> fed_samples_{0};
+    uint32_t fetched_samples_ = 0;
+    std::mutex statistics_mutex_;
+    AudioProcessorStatistics statistics_;
 
     void AudioProcessorTask();
+    void PushToRing(const int16_t* data, size_t samples);
+    void PopFromRing(int16_t* data, size_t samples);
 };
 
 #endif 
\ No newline at end of file
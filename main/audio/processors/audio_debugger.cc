@@ -6,6 +6,7 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
 #include <cstring>
 #include <string>
 #endif
@@ -14,22 +15,68 @@
 
 
 AudioDebugger::AudioDebugger() {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    for (int tap = 0; tap < kAudioDebugTapCount; tap++) {
+        if (IsTapEnabled((AudioDebugTap)tap)) {
+            datagrams_[tap].resize(sizeof(AudioDebugHeader) + AUDIO_DEBUG_MAX_SAMPLES * sizeof(int16_t));
+        }
+    }
+#endif
+}
+
+AudioDebugger::~AudioDebugger() {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    if (udp_sockfd_ >= 0) {
+        close(udp_sockfd_);
+        ESP_LOGI(TAG, "Closed UDP socket");
+    }
+#endif
+}
+
+bool AudioDebugger::IsTapEnabled(AudioDebugTap tap) {
+    switch (tap) {
+#if CONFIG_AUDIO_DEBUG_TAP_MIC
+        case kAudioDebugTapMic:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_REFERENCE
+        case kAudioDebugTapReference:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_PROCESSED
+        case kAudioDebugTapProcessed:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_DECODED
+        case kAudioDebugTapDecoded:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_PLAYBACK
+        case kAudioDebugTapPlayback:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+void AudioDebugger::OpenSocket() {
 #if CONFIG_USE_AUDIO_DEBUGGER
     udp_sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
     if (udp_sockfd_ >= 0) {
         // 解析配置的服务器地址 "IP:PORT"
         std::string server_addr = CONFIG_AUDIO_DEBUG_UDP_SERVER;
         size_t colon_pos = server_addr.find(':');
-        
+
         if (colon_pos != std::string::npos) {
             std::string ip = server_addr.substr(0, colon_pos);
             int port = std::stoi(server_addr.substr(colon_pos + 1));
-            
+
             memset(&udp_server_addr_, 0, sizeof(udp_server_addr_));
             udp_server_addr_.sin_family = AF_INET;
             udp_server_addr_.sin_port = htons(port);
             inet_pton(AF_INET, ip.c_str(), &udp_server_addr_.sin_addr);
-            
+
             ESP_LOGI(TAG, "Initialized server address: %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
         } else {
             ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
@@ -42,27 +89,40 @@ AudioDebugger::AudioDebugger() {
 #endif
 }
 
-AudioDebugger::~AudioDebugger() {
+void AudioDebugger::Feed(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, int64_t time_us, int stride) {
 #if CONFIG_USE_AUDIO_DEBUGGER
-    if (udp_sockfd_ >= 0) {
-        close(udp_sockfd_);
-        ESP_LOGI(TAG, "Closed UDP socket");
+    if (tap >= kAudioDebugTapCount || datagrams_[tap].empty() || sample_rate <= 0) {
+        return;
+    }
+    std::call_once(socket_once_, [this]() { OpenSocket(); });
+    if (udp_sockfd_ < 0) {
+        return;
     }
-#endif
-}
 
-void AudioDebugger::Feed(const std::vector<int16_t>& data) {
-#if CONFIG_USE_AUDIO_DEBUGGER
-    if (udp_sockfd_ >= 0) {
-        ssize_t sent = sendto(udp_sockfd_, data.data(), data.size() * sizeof(int16_t), 0,
+    /* Split into datagrams of at most AUDIO_DEBUG_MAX_SAMPLES, each stamped with its first sample's time */
+    auto& datagram = datagrams_[tap];
+    auto header = reinterpret_cast<AudioDebugHeader*>(datagram.data());
+    auto pcm = reinterpret_cast<int16_t*>(datagram.data() + sizeof(AudioDebugHeader));
+    for (size_t offset = 0; offset < samples; offset += AUDIO_DEBUG_MAX_SAMPLES) {
+        size_t count = std::min<size_t>(samples - offset, AUDIO_DEBUG_MAX_SAMPLES);
+        header->magic = AUDIO_DEBUG_MAGIC;
+        header->version = AUDIO_DEBUG_VERSION;
+        header->tap = tap;
+        header->reserved = 0;
+        header->sample_rate = sample_rate;
+        header->sequence = sequences_[tap]++;
+        header->timestamp_us = time_us + (int64_t)offset * 1000000 / sample_rate;
+        for (size_t i = 0; i < count; i++) {
+            pcm[i] = data[(offset + i) * stride];
+        }
+
+        size_t size = sizeof(AudioDebugHeader) + count * sizeof(int16_t);
+        ssize_t sent = sendto(udp_sockfd_, datagram.data(), size, 0,
                              (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
         if (sent < 0) {
             ESP_LOGW(TAG, "Failed to send audio data to %s: %d", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno);
-        } else {
-            ESP_LOGD(TAG, "Sent %d bytes audio data to %s", sent, CONFIG_AUDIO_DEBUG_UDP_SERVER);
+            return;
         }
     }
 #endif
 }
-
- 
\ No newline at end of file
@@ -1,22 +1,66 @@
 #ifndef AUDIO_DEBUGGER_H
 #define AUDIO_DEBUGGER_H
 
+#include <array>
+#include <mutex>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+// Points of the audio pipeline that can be captured, the tap ID on the wire
+enum AudioDebugTap : uint8_t {
+    kAudioDebugTapMic,          // Codec input, first channel, at the codec input rate
+    kAudioDebugTapReference,    // Codec input, AEC reference channel
+    kAudioDebugTapProcessed,    // Audio processor output handed to the encoder
+    kAudioDebugTapDecoded,      // Opus decoder output, before resampling
+    kAudioDebugTapPlayback,     // Mixed PCM written to the codec
+    kAudioDebugTapCount,
+};
+
+#define AUDIO_DEBUG_MAGIC 0xAD
+#define AUDIO_DEBUG_VERSION 1
+// Keeps every datagram within one Ethernet MTU
+#define AUDIO_DEBUG_MAX_SAMPLES 640
+
+/*
+ * Every datagram carries 16-bit mono PCM of one tap behind this little-endian header. The sequence
+ * counts datagrams per tap, so the receiver can tell drops; the timestamp is the esp_timer time of
+ * the first sample, which puts all taps on one clock. scripts/audio_debug_server.py records them.
+ */
+struct __attribute__((packed)) AudioDebugHeader {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t tap;
+    uint8_t reserved;
+    uint32_t sample_rate;
+    uint32_t sequence;
+    int64_t timestamp_us;
+};
+
+/*
+ * Streams PCM from the enabled taps (CONFIG_AUDIO_DEBUG_TAP_*) over UDP to CONFIG_AUDIO_DEBUG_UDP_SERVER.
+ * Each tap is fed by a single task; the socket is opened on the first Feed().
+ */
 class AudioDebugger {
 public:
     AudioDebugger();
     ~AudioDebugger();
 
-    void Feed(const std::vector<int16_t>& data);
+    // Sends `samples` samples read every `stride` values, i.e. one channel of interleaved frames
+    void Feed(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, int64_t time_us, int stride = 1);
 
 private:
     int udp_sockfd_ = -1;
     struct sockaddr_in udp_server_addr_;
+    std::once_flag socket_once_;
+    std::array<uint32_t, kAudioDebugTapCount> sequences_{};
+    std::array<std::vector<uint8_t>, kAudioDebugTapCount> datagrams_;
+
+    void OpenSocket();
+    static bool IsTapEnabled(AudioDebugTap tap);
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -1,10 +1,15 @@
 #include "no_audio_processor.h"
+#include "audio_kernels.h"
 #include <esp_log.h>
 
 #define TAG "NoAudioProcessor"
 
 void NoAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
+    SetFrameDuration(frame_duration_ms);
+}
+
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
     frame_samples_ = frame_duration_ms * 16000 / 1000;
 }
 
@@ -14,12 +19,11 @@ void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
     }
 
     if (codec_->input_channels() == 2) {
-        // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
-        }
-        output_callback_(std::move(mono_data));
+        // If input channels is 2, we need to fetch the left channel data (in place, the buffer is reused by the caller)
+        size_t mono_samples = data.size() / 2;
+        audio_extract_channel_s16(data.data(), data.data(), mono_samples, 2, 0);
+        data.resize(mono_samples);
+        output_callback_(std::move(data));
     } else {
         output_callback_(std::move(data));
     }
@@ -57,3 +61,7 @@ void NoAudioProcessor::EnableDeviceAec(bool enable) {
         ESP_LOGE(TAG, "Device AEC is not supported");
     }
 }
+
+AudioProcessorStatistics NoAudioProcessor::GetStatistics() {
+    return AudioProcessorStatistics();
+}
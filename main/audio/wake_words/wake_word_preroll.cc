@@ -0,0 +1,223 @@
+#include "wake_word_preroll.h"
+#include "audio_service.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "WakeWordPreroll"
+
+// The Opus encoder needs a deep stack, which is kept in PSRAM
+#define ENCODER_TASK_STACK_SIZE (4096 * 7)
+#define FRAME_SAMPLES (WAKE_WORD_PREROLL_SAMPLE_RATE * OPUS_FRAME_DURATION_MS / 1000)
+#define MAX_PACKETS (WAKE_WORD_PREROLL_MS / OPUS_FRAME_DURATION_MS)
+
+WakeWordPreroll::~WakeWordPreroll() {
+    if (encoder_task_ != nullptr) {
+        vTaskDelete(encoder_task_);
+    }
+    if (encoder_task_stack_ != nullptr) {
+        heap_caps_free(encoder_task_stack_);
+    }
+    if (encoder_task_buffer_ != nullptr) {
+        heap_caps_free(encoder_task_buffer_);
+    }
+    if (pcm_ != nullptr) {
+        heap_caps_free(pcm_);
+    }
+}
+
+bool WakeWordPreroll::Initialize() {
+    if (pcm_ != nullptr) {
+        return true;
+    }
+    capacity_ = WAKE_WORD_PREROLL_SAMPLE_RATE * WAKE_WORD_PREROLL_MS / 1000;
+    pcm_ = (int16_t*)heap_caps_malloc(capacity_ * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    if (pcm_ == nullptr) {
+        pcm_ = (int16_t*)heap_caps_malloc(capacity_ * sizeof(int16_t), MALLOC_CAP_8BIT);
+    }
+    if (pcm_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate the pre-roll ring");
+        return false;
+    }
+
+    frame_.reserve(FRAME_SAMPLES);
+    packets_.resize(MAX_PACKETS);
+
+#if CONFIG_WAKE_WORD_PREROLL_ENCODER
+    CreateEncoder();
+    encoder_task_ = StartEncoderTask([](void* arg) {
+        auto this_ = (WakeWordPreroll*)arg;
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            this_->EncodePending();
+            if (this_->flush_requested_.exchange(false)) {
+                this_->Publish();
+            }
+        }
+    }, "wake_word_preroll");
+    return encoder_task_ != nullptr;
+#else
+    return true;
+#endif
+}
+
+void WakeWordPreroll::CreateEncoder() {
+    encoder_ = std::make_unique<OpusEncoderWrapper>(WAKE_WORD_PREROLL_SAMPLE_RATE, 1, OPUS_FRAME_DURATION_MS);
+    encoder_->SetComplexity(0); // 0 is the fastest
+}
+
+TaskHandle_t WakeWordPreroll::StartEncoderTask(TaskFunction_t function, const char* name) {
+    if (encoder_task_stack_ == nullptr) {
+        encoder_task_stack_ = (StackType_t*)heap_caps_malloc(ENCODER_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    }
+    if (encoder_task_buffer_ == nullptr) {
+        encoder_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    }
+    if (encoder_task_stack_ == nullptr || encoder_task_buffer_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate the encoder task");
+        return nullptr;
+    }
+    return xTaskCreateStatic(function, name, ENCODER_TASK_STACK_SIZE, this, 2,
+        encoder_task_stack_, encoder_task_buffer_);
+}
+
+void WakeWordPreroll::Store(const int16_t* data, size_t samples) {
+    if (pcm_ == nullptr) {
+        return;
+    }
+    bool frame_ready;
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        // Only the newest capacity_ samples of a large block survive anyway
+        if (samples > capacity_) {
+            write_position_ += samples - capacity_;
+            data += samples - capacity_;
+            samples = capacity_;
+        }
+        size_t offset = write_position_ % capacity_;
+        size_t first = std::min(samples, capacity_ - offset);
+        memcpy(pcm_ + offset, data, first * sizeof(int16_t));
+        memcpy(pcm_, data + first, (samples - first) * sizeof(int16_t));
+        write_position_ += samples;
+        frame_ready = write_position_ - encode_position_ >= FRAME_SAMPLES;
+    }
+#if CONFIG_WAKE_WORD_PREROLL_ENCODER
+    if (frame_ready && encoder_task_ != nullptr) {
+        xTaskNotifyGive(encoder_task_);
+    }
+#else
+    (void)frame_ready;
+#endif
+}
+
+void WakeWordPreroll::EncodePending() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(pcm_mutex_);
+            // Samples overwritten before they were encoded are skipped
+            if (write_position_ - encode_position_ > capacity_) {
+                encode_position_ = write_position_ - capacity_;
+            }
+            if (write_position_ - encode_position_ < FRAME_SAMPLES) {
+                return;
+            }
+            frame_.resize(FRAME_SAMPLES);
+            size_t offset = encode_position_ % capacity_;
+            size_t first = std::min<size_t>(FRAME_SAMPLES, capacity_ - offset);
+            memcpy(frame_.data(), pcm_ + offset, first * sizeof(int16_t));
+            memcpy(frame_.data() + first, pcm_, (FRAME_SAMPLES - first) * sizeof(int16_t));
+            encode_position_ += FRAME_SAMPLES;
+        }
+
+        // A full ring overwrites its oldest packet
+        auto& packet = packets_[(packet_head_ + packet_count_) % packets_.size()];
+        bool full = packet_count_ == packets_.size();
+        if (encoder_->Encode(std::move(frame_), packet)) {
+            if (full) {
+                packet_head_ = (packet_head_ + 1) % packets_.size();
+            } else {
+                packet_count_++;
+            }
+        } else if (full) {
+            packet_head_ = (packet_head_ + 1) % packets_.size();
+            packet_count_--;
+        }
+    }
+}
+
+void WakeWordPreroll::Publish() {
+    // The next detection starts from an empty ring, before the reader can restart it
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        write_position_ = 0;
+        encode_position_ = 0;
+    }
+    encoder_->ResetState();
+
+    ESP_LOGI(TAG, "Wake word opus %u packets ready in %ld ms", (unsigned)packet_count_,
+        (long)((esp_timer_get_time() - encode_start_time_) / 1000));
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    for (size_t i = 0; i < packet_count_; i++) {
+        auto& packet = packets_[(packet_head_ + i) % packets_.size()];
+        // The background encoder keeps its buffers for the next detection, a one-off encode hands them over
+        if (encoder_task_ != nullptr) {
+            output_.emplace_back(packet.begin(), packet.end());
+        } else {
+            output_.push_back(std::move(packet));
+        }
+    }
+    packet_head_ = 0;
+    packet_count_ = 0;
+    output_.push_back(std::vector<uint8_t>());
+    output_cv_.notify_all();
+}
+
+void WakeWordPreroll::Encode() {
+    if (pcm_ == nullptr) {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        output_.clear();
+        output_.push_back(std::vector<uint8_t>());
+        output_cv_.notify_all();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        output_.clear();
+    }
+    encode_start_time_ = esp_timer_get_time();
+
+#if CONFIG_WAKE_WORD_PREROLL_ENCODER
+    if (encoder_task_ != nullptr) {
+        flush_requested_ = true;
+        xTaskNotifyGive(encoder_task_);
+        return;
+    }
+#endif
+    auto task = StartEncoderTask([](void* arg) {
+        auto this_ = (WakeWordPreroll*)arg;
+        // Only needed right after a detection, so the encoder is not kept between them
+        this_->CreateEncoder();
+        this_->EncodePending();
+        this_->Publish();
+        this_->encoder_.reset();
+        vTaskDelete(NULL);
+    }, "encode_wake_word");
+    if (task == nullptr) {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        output_.push_back(std::vector<uint8_t>());
+        output_cv_.notify_all();
+    }
+}
+
+bool WakeWordPreroll::GetOpus(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(output_mutex_);
+    output_cv_.wait(lock, [this]() {
+        return !output_.empty();
+    });
+    opus.swap(output_.front());
+    output_.pop_front();
+    return !opus.empty();
+}
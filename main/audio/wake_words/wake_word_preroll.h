@@ -0,0 +1,77 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <opus_encoder.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+// Audio kept before the wake word is detected, at 16 kHz mono
+#define WAKE_WORD_PREROLL_MS 2000
+#define WAKE_WORD_PREROLL_SAMPLE_RATE 16000
+
+/*
+ * The audio around a wake word, sent to the server as the first message of a conversation.
+ *
+ * The detector stores its input in a fixed PCM ring (in PSRAM when available). With
+ * CONFIG_WAKE_WORD_PREROLL_ENCODER a background task encodes the ring as it fills and keeps the
+ * latest WAKE_WORD_PREROLL_MS of Opus packets, so after detection only the last frame is left to
+ * encode. Without it the whole ring is encoded once the wake word is detected, as before.
+ */
+class WakeWordPreroll {
+public:
+    WakeWordPreroll() = default;
+    ~WakeWordPreroll();
+
+    WakeWordPreroll(const WakeWordPreroll&) = delete;
+    WakeWordPreroll& operator=(const WakeWordPreroll&) = delete;
+
+    bool Initialize();
+    // Detection task: appends PCM, overwriting the oldest samples
+    void Store(const int16_t* data, size_t samples);
+    // After detection: encodes what is left and hands the packets to GetOpus()
+    void Encode();
+    // Blocks until the next packet is ready, returns false after the last one
+    bool GetOpus(std::vector<uint8_t>& opus);
+
+private:
+    int16_t* pcm_ = nullptr;
+    size_t capacity_ = 0;
+    // Free-running sample counts, the ring holds [write_position_ - capacity_, write_position_)
+    size_t write_position_ = 0;
+    size_t encode_position_ = 0;
+    std::mutex pcm_mutex_;
+
+    // Owned by the encoder task
+    std::unique_ptr<OpusEncoderWrapper> encoder_;
+    std::vector<int16_t> frame_;
+    // The latest encoded packets, oldest at packet_head_. The payload buffers are reused frame after frame
+    std::vector<std::vector<uint8_t>> packets_;
+    size_t packet_head_ = 0;
+    size_t packet_count_ = 0;
+    int64_t encode_start_time_ = 0;
+
+    std::deque<std::vector<uint8_t>> output_;
+    std::mutex output_mutex_;
+    std::condition_variable output_cv_;
+
+    TaskHandle_t encoder_task_ = nullptr;     // The background encoder, if enabled
+    StaticTask_t* encoder_task_buffer_ = nullptr;
+    StackType_t* encoder_task_stack_ = nullptr;
+    std::atomic<bool> flush_requested_{false};
+
+    void CreateEncoder();
+    TaskHandle_t StartEncoderTask(TaskFunction_t function, const char* name);
+    void EncodePending();
+    void Publish();
+};
+
+#endif // WAKE_WORD_PREROLL_H
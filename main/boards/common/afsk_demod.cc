@@ -1,8 +1,14 @@
 #include "afsk_demod.h"
-#include <cstring>
+#include <cmath>
+#include <limits>
 #include <algorithm>
 #include "esp_log.h"
-#include "display.h"
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3 && __has_include(<dsps_dotprod.h>)
+#include <dsps_dotprod.h>
+#define AFSK_USE_DSP 1
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -12,96 +18,8 @@ namespace audio_wifi_config
 {
     static const char *kLogTag = "AUDIO_WIFI_CONFIG";
 
-    void ReceiveWifiCredentialsFromAudio(Application *app,
-                                        WifiConfigurationAp *wifi_ap,
-                                        Display *display,
-                                        size_t input_channels
-                                    )
-    {
-        const int kInputSampleRate = 16000;                                    // Input sampling rate
-        const float kDownsampleStep = static_cast<float>(kInputSampleRate) / static_cast<float>(kAudioSampleRate); // Downsampling step
-        std::vector<int16_t> audio_data;
-        AudioSignalProcessor signal_processor(kAudioSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate, kWindowSize);
-        AudioDataBuffer data_buffer;
-
-        while (true)
-        {
-            // 检查Application状态，只有在WiFi配置模式下才处理音频
-            if (app->GetDeviceState() != kDeviceStateWifiConfiguring) {
-                // 不在WiFi配置状态，休眠100ms后再检查
-                vTaskDelay(pdMS_TO_TICKS(100));
-                continue;
-            }
-            
-            if (!app->GetAudioService().ReadAudioData(audio_data, 16000, 480)) { // 16kHz, 480 samples corresponds to 30ms data
-                // 读取音频失败，短暂延迟后重试
-                ESP_LOGI(kLogTag, "Failed to read audio data, retrying.");
-                vTaskDelay(pdMS_TO_TICKS(10));
-                continue;
-            }
-
-            if (input_channels == 2) { // 如果是双声道输入，转换为单声道
-                auto mono_data = std::vector<int16_t>(audio_data.size() / 2);
-                for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                    mono_data[i] = audio_data[j];
-                }
-                audio_data = std::move(mono_data);
-            }
-            
-            // Downsample the audio data
-            std::vector<float> downsampled_data;
-            size_t last_index = 0;
-
-            if (kDownsampleStep > 1.0f) {
-                downsampled_data.reserve(audio_data.size() / static_cast<size_t>(kDownsampleStep));
-                for (size_t i = 0; i < audio_data.size(); ++i) {
-                    size_t sample_index = static_cast<size_t>(i / kDownsampleStep);
-                    if ((sample_index + 1) > last_index) {
-                        downsampled_data.push_back(static_cast<float>(audio_data[i]));
-                        last_index = sample_index + 1;
-                    }
-                }
-            } else {
-                downsampled_data.reserve(audio_data.size());
-                for (int16_t sample : audio_data) {
-                    downsampled_data.push_back(static_cast<float>(sample));
-                }
-            }
-            
-            // Process audio samples to get probability data
-            auto probabilities = signal_processor.ProcessAudioSamples(downsampled_data);
-            
-            // Feed probability data to the data buffer
-            if (data_buffer.ProcessProbabilityData(probabilities, 0.5f)) {
-                // If complete data was received, extract WiFi credentials
-                if (data_buffer.decoded_text.has_value()) {
-                    ESP_LOGI(kLogTag, "Received text data: %s", data_buffer.decoded_text->c_str());
-                    display->SetChatMessage("system", data_buffer.decoded_text->c_str());
-                    
-                    // Split SSID and password by newline character
-                    std::string wifi_ssid, wifi_password;
-                    size_t newline_position = data_buffer.decoded_text->find('\n');
-                    if (newline_position != std::string::npos) {
-                        wifi_ssid = data_buffer.decoded_text->substr(0, newline_position);
-                        wifi_password = data_buffer.decoded_text->substr(newline_position + 1);
-                        ESP_LOGI(kLogTag, "WiFi SSID: %s, Password: %s", wifi_ssid.c_str(), wifi_password.c_str());
-                    } else {
-                        ESP_LOGE(kLogTag, "Invalid data format, no newline character found");
-                        continue;
-                    }
-                    
-                    if (wifi_ap->ConnectToWifi(wifi_ssid, wifi_password)) {
-                        wifi_ap->Save(wifi_ssid, wifi_password);  // Save WiFi credentials
-                        esp_restart();                            // Restart device to apply new WiFi configuration
-                    } else {
-                        ESP_LOGE(kLogTag, "Failed to connect to WiFi with received credentials");
-                    }
-                    data_buffer.decoded_text.reset();  // Clear processed data
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(1));  // 1ms delay
-        }
-    }
+    // Largest block sample the Q15 correlations take: 512 * 32767 * 64 stays below 2^30
+    static const int kCorrelationPeak = 511;
 
     // Default start and end transmission identifiers
     // \x01\x02 = 00000001 00000010
@@ -112,106 +30,119 @@ namespace audio_wifi_config
     const std::vector<uint8_t> kDefaultEndTransmissionPattern = {
         0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 1, 0, 0};
 
-    // FrequencyDetector implementation
-    FrequencyDetector::FrequencyDetector(float frequency, size_t window_size)
-        : frequency_(frequency), window_size_(window_size) {
-        frequency_bin_ = std::floor(frequency_ * static_cast<float>(window_size_));
-        angular_frequency_ = 2.0f * M_PI * frequency_;
-        cos_coefficient_ = std::cos(angular_frequency_);
-        sin_coefficient_ = std::sin(angular_frequency_);
-        filter_coefficient_ = 2.0f * cos_coefficient_;
-
-        // Initialize state buffer
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
-    }
-
-    void FrequencyDetector::Reset() {
-        state_buffer_.clear();
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
+    // GoertzelBank implementation
+    GoertzelBank::GoertzelBank(size_t sample_rate, size_t mark_frequency, size_t space_frequency) {
+        float mark_angular_frequency = 2.0f * M_PI * static_cast<float>(mark_frequency) / static_cast<float>(sample_rate);
+        float space_angular_frequency = 2.0f * M_PI * static_cast<float>(space_frequency) / static_cast<float>(sample_rate);
+        for (size_t n = 0; n < kWindowSize; ++n) {
+            mark_cos_[n] = static_cast<int16_t>(std::lround(32767.0f * std::cos(mark_angular_frequency * n)));
+            mark_sin_[n] = static_cast<int16_t>(std::lround(32767.0f * std::sin(mark_angular_frequency * n)));
+            space_cos_[n] = static_cast<int16_t>(std::lround(32767.0f * std::cos(space_angular_frequency * n)));
+            space_sin_[n] = static_cast<int16_t>(std::lround(32767.0f * std::sin(space_angular_frequency * n)));
+        }
     }
 
-    void FrequencyDetector::ProcessSample(float sample) {
-        if (state_buffer_.size() < 2) {
-            return;
+    float GoertzelBank::ProcessBlock(const int16_t *block, size_t samples) {
+        // Scale loud blocks down into the correlation headroom; only the ratio of the tones matters
+        int peak = 0;
+        for (size_t n = 0; n < samples; ++n) {
+            peak = std::max(peak, std::abs(static_cast<int>(block[n])));
+        }
+        int shift = 0;
+        while ((peak >> shift) > kCorrelationPeak) {
+            shift++;
+        }
+        for (size_t n = 0; n < samples; ++n) {
+            scaled_[n] = block[n] >> shift;
         }
 
-        float s_minus_2 = state_buffer_.front();  // S[-2]
-        state_buffer_.pop_front();
-        float s_minus_1 = state_buffer_.front();  // S[-1]
-        state_buffer_.pop_front();
-
-        float s_current = sample + filter_coefficient_ * s_minus_1 - s_minus_2;
-
-        state_buffer_.push_back(s_minus_1);  // Put S[-1] back
-        state_buffer_.push_back(s_current);  // Add new S[0]
-    }
-
-    float FrequencyDetector::GetAmplitude() const {
-        if (state_buffer_.size() < 2) {
-            return 0.0f;
+        int32_t mark_real, mark_imaginary, space_real, space_imaginary;
+#if AFSK_USE_DSP
+        int16_t result;
+        dsps_dotprod_s16(scaled_.data(), mark_cos_.data(), &result, samples, 0);
+        mark_real = result;
+        dsps_dotprod_s16(scaled_.data(), mark_sin_.data(), &result, samples, 0);
+        mark_imaginary = result;
+        dsps_dotprod_s16(scaled_.data(), space_cos_.data(), &result, samples, 0);
+        space_real = result;
+        dsps_dotprod_s16(scaled_.data(), space_sin_.data(), &result, samples, 0);
+        space_imaginary = result;
+#else
+        // Both tones in one pass over the block
+        mark_real = mark_imaginary = space_real = space_imaginary = 0;
+        for (size_t n = 0; n < samples; ++n) {
+            int32_t sample = scaled_[n];
+            mark_real += sample * mark_cos_[n];
+            mark_imaginary += sample * mark_sin_[n];
+            space_real += sample * space_cos_[n];
+            space_imaginary += sample * space_sin_[n];
         }
+        mark_real >>= 15;
+        mark_imaginary >>= 15;
+        space_real >>= 15;
+        space_imaginary >>= 15;
+#endif
 
-        float s_minus_1 = state_buffer_[1];                      // S[-1]
-        float s_minus_2 = state_buffer_[0];                      // S[-2]
-        float real_part = cos_coefficient_ * s_minus_1 - s_minus_2;  // Real part
-        float imaginary_part = sin_coefficient_ * s_minus_1;         // Imaginary part
+        float mark_amplitude = std::sqrt(static_cast<float>(mark_real * mark_real + mark_imaginary * mark_imaginary));
+        float space_amplitude = std::sqrt(static_cast<float>(space_real * space_real + space_imaginary * space_imaginary));
 
-        return std::sqrt(real_part * real_part + imaginary_part * imaginary_part) / 
-               (static_cast<float>(window_size_) / 2.0f);
+        // Avoid division by zero
+        return mark_amplitude / (space_amplitude + mark_amplitude + std::numeric_limits<float>::epsilon());
     }
 
     // AudioSignalProcessor implementation
-    AudioSignalProcessor::AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
-                                             size_t bit_rate, size_t window_size)
-        : input_buffer_size_(window_size), output_sample_count_(0) {
+    AudioSignalProcessor::AudioSignalProcessor(size_t input_sample_rate, size_t sample_rate, size_t mark_frequency,
+                                             size_t space_frequency, size_t bit_rate, size_t window_size)
+        : goertzel_bank_(sample_rate, mark_frequency, space_frequency),
+          bit_sample_count_(0),
+          input_sample_rate_(input_sample_rate),
+          sample_rate_(sample_rate),
+          decimation_phase_(0) {
         if (sample_rate % bit_rate != 0) {
             // On ESP32 we can continue execution, but log the error
             ESP_LOGW(kLogTag, "Sample rate %zu is not divisible by bit rate %zu", sample_rate, bit_rate);
         }
-
-        float normalized_mark_freq = static_cast<float>(mark_frequency) / static_cast<float>(sample_rate);
-        float normalized_space_freq = static_cast<float>(space_frequency) / static_cast<float>(sample_rate);
-
-        mark_detector_ = std::make_unique<FrequencyDetector>(normalized_mark_freq, window_size);
-        space_detector_ = std::make_unique<FrequencyDetector>(normalized_space_freq, window_size);
+        if (input_sample_rate < sample_rate) {
+            ESP_LOGW(kLogTag, "Input rate %zu is below the analysis rate %zu", input_sample_rate, sample_rate);
+            input_sample_rate_ = sample_rate;
+        }
 
         samples_per_bit_ = sample_rate / bit_rate;  // Number of samples per bit
+        window_size_ = std::min({window_size, kWindowSize, samples_per_bit_});
+        if (window_size_ != window_size) {
+            ESP_LOGW(kLogTag, "Window size %zu limited to %zu", window_size, window_size_);
+        }
     }
 
-    std::vector<float> AudioSignalProcessor::ProcessAudioSamples(const std::vector<float> &samples) {
-        std::vector<float> result;
-
-        for (float sample : samples) {
-            if (input_buffer_.size() < input_buffer_size_) {
-                input_buffer_.push_back(sample);  // Just add, don't process yet
-            } else {
-                // Input buffer is full, process the data
-                input_buffer_.pop_front();   // Remove oldest sample
-                input_buffer_.push_back(sample);  // Add new sample
-                output_sample_count_++;
-
-                if (output_sample_count_ >= samples_per_bit_) {
-                    // Process all samples in the window using Goertzel algorithm
-                    for (float window_sample : input_buffer_) {
-                        mark_detector_->ProcessSample(window_sample);
-                        space_detector_->ProcessSample(window_sample);
-                    }
+    size_t AudioSignalProcessor::GetMaxProbabilities(size_t count) const {
+        size_t analysis_samples = count * sample_rate_ / input_sample_rate_ + 1;
+        return analysis_samples / samples_per_bit_ + 1;
+    }
 
-                    float mark_amplitude = mark_detector_->GetAmplitude();   // Mark amplitude
-                    float space_amplitude = space_detector_->GetAmplitude(); // Space amplitude
+    size_t AudioSignalProcessor::ProcessAudioSamples(const int16_t *samples, size_t count, float *probabilities,
+                                                     size_t max_probabilities) {
+        size_t result = 0;
+        size_t window_start = samples_per_bit_ - window_size_;
 
-                    // Avoid division by zero
-                    float mark_probability = mark_amplitude / 
-                                           (space_amplitude + mark_amplitude + std::numeric_limits<float>::epsilon());
-                    result.push_back(mark_probability);
+        for (size_t i = 0; i < count; ++i) {
+            // Keep one input sample per analysis sample, the first at or after its time
+            bool keep = decimation_phase_ <= 0;
+            decimation_phase_ += (keep ? input_sample_rate_ : 0) - sample_rate_;
+            if (!keep) {
+                continue;
+            }
 
-                    // Reset detector windows
-                    mark_detector_->Reset();
-                    space_detector_->Reset();
-                    output_sample_count_ = 0;  // Reset output counter
-                }
+            // The window covers the end of the bit
+            if (bit_sample_count_ >= window_start) {
+                window_[bit_sample_count_ - window_start] = samples[i];
+            }
+            if (++bit_sample_count_ < samples_per_bit_) {
+                continue;
+            }
+            bit_sample_count_ = 0;
+
+            if (result < max_probabilities) {
+                probabilities[result++] = goertzel_bank_.ProcessBlock(window_.data(), window_size_);
             }
         }
 
@@ -225,6 +156,10 @@ namespace audio_wifi_config
           end_of_transmission_(kDefaultEndTransmissionPattern),
           enable_checksum_validation_(true) {
         identifier_buffer_size_ = std::max(start_of_transmission_.size(), end_of_transmission_.size());
+        start_bits_ = PackIdentifier(start_of_transmission_);
+        end_bits_ = PackIdentifier(end_of_transmission_);
+        identifier_bits_ = 0;
+        identifier_bit_count_ = 0;
         max_bit_buffer_size_ = 776;  // Preset bit buffer size, 776 bits = (32 + 1 + 63 + 1) * 8 = 776
 
         bit_buffer_.reserve(max_bit_buffer_size_);
@@ -237,6 +172,13 @@ namespace audio_wifi_config
           end_of_transmission_(end_identifier),
           enable_checksum_validation_(enable_checksum) {
         identifier_buffer_size_ = std::max(start_of_transmission_.size(), end_of_transmission_.size());
+        if (identifier_buffer_size_ > 64) {
+            ESP_LOGE(kLogTag, "Identifiers longer than 64 bits are not supported");
+        }
+        start_bits_ = PackIdentifier(start_of_transmission_);
+        end_bits_ = PackIdentifier(end_of_transmission_);
+        identifier_bits_ = 0;
+        identifier_bit_count_ = 0;
         max_bit_buffer_size_ = max_byte_size * 8;  // Bit buffer size in bytes
 
         bit_buffer_.reserve(max_bit_buffer_size_);
@@ -250,24 +192,42 @@ namespace audio_wifi_config
         return checksum;
     }
 
+    uint64_t AudioDataBuffer::PackIdentifier(const std::vector<uint8_t> &identifier) {
+        uint64_t packed = 0;
+        for (uint8_t bit : identifier) {
+            packed = (packed << 1) | (bit & 1);
+        }
+        return packed;
+    }
+
+    bool AudioDataBuffer::MatchIdentifier(const std::vector<uint8_t> &identifier, uint64_t packed) const {
+        size_t size = identifier.size();
+        if (size == 0 || size > 64 || identifier_bit_count_ < size) {
+            return false;
+        }
+        uint64_t mask = size == 64 ? ~0ULL : (1ULL << size) - 1;
+        return (identifier_bits_ & mask) == packed;
+    }
+
     void AudioDataBuffer::ClearBuffers() {
-        identifier_buffer_.clear();
+        identifier_bits_ = 0;
+        identifier_bit_count_ = 0;
         bit_buffer_.clear();
     }
 
-    bool AudioDataBuffer::ProcessProbabilityData(const std::vector<float> &probabilities, float threshold) {
-        for (float probability : probabilities) {
-            uint8_t bit = (probability > threshold) ? 1 : 0;
+    bool AudioDataBuffer::ProcessProbabilityData(const float *probabilities, size_t count, float threshold) {
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t bit = (probabilities[i] > threshold) ? 1 : 0;
 
-            if (identifier_buffer_.size() >= identifier_buffer_size_) {
-                identifier_buffer_.pop_front();  // Maintain buffer size
+            identifier_bits_ = (identifier_bits_ << 1) | bit;
+            if (identifier_bit_count_ < identifier_buffer_size_) {
+                identifier_bit_count_++;
             }
-            identifier_buffer_.push_back(bit);
 
             // Process received bit based on state machine
             switch (current_state_) {
             case DataReceptionState::kInactive:
-                if (identifier_buffer_.size() >= start_of_transmission_.size()) {
+                if (identifier_bit_count_ >= start_of_transmission_.size()) {
                     current_state_ = DataReceptionState::kWaiting;  // Enter waiting state
                     ESP_LOGI(kLogTag, "Entering Waiting state");
                 }
@@ -275,22 +235,17 @@ namespace audio_wifi_config
 
             case DataReceptionState::kWaiting:
                 // Waiting state, possibly waiting for transmission end
-                if (identifier_buffer_.size() >= start_of_transmission_.size()) {
-                    std::vector<uint8_t> identifier_snapshot(identifier_buffer_.begin(), identifier_buffer_.end());
-                    if (identifier_snapshot == start_of_transmission_)
-                    {
-                        ClearBuffers();                                // Clear buffers
-                        current_state_ = DataReceptionState::kReceiving;  // Enter receiving state
-                        ESP_LOGI(kLogTag, "Entering Receiving state");
-                    }
+                if (MatchIdentifier(start_of_transmission_, start_bits_)) {
+                    ClearBuffers();                                // Clear buffers
+                    current_state_ = DataReceptionState::kReceiving;  // Enter receiving state
+                    ESP_LOGI(kLogTag, "Entering Receiving state");
                 }
                 break;
 
             case DataReceptionState::kReceiving:
                 bit_buffer_.push_back(bit);
-                if (identifier_buffer_.size() >= end_of_transmission_.size()) {
-                    std::vector<uint8_t> identifier_snapshot(identifier_buffer_.begin(), identifier_buffer_.end());
-                    if (identifier_snapshot == end_of_transmission_) {
+                if (identifier_bit_count_ >= end_of_transmission_.size()) {
+                    if (MatchIdentifier(end_of_transmission_, end_bits_)) {
                         current_state_ = DataReceptionState::kInactive;  // Enter inactive state
 
                         // Convert bits to bytes
@@ -1,13 +1,15 @@
 #pragma once
 
+#include <array>
 #include <vector>
-#include <deque>
 #include <string>
-#include <memory>
 #include <optional>
-#include <cmath>
-#include "wifi_configuration_ap.h"
-#include "application.h"
+#include <cstddef>
+#include <cstdint>
+
+class Application;
+class WifiConfigurationAp;
+class Display;
 
 // Audio signal processing constants for WiFi configuration via audio
 const size_t kAudioSampleRate = 6400;
@@ -19,83 +21,85 @@ const size_t kWindowSize = 64;
 namespace audio_wifi_config
 {
     // Main function to receive WiFi credentials through audio signal
-    void ReceiveWifiCredentialsFromAudio(Application *app, WifiConfigurationAp *wifi_ap, Display *display, 
+    void ReceiveWifiCredentialsFromAudio(Application *app, WifiConfigurationAp *wifi_ap, Display *display,
                                          size_t input_channels = 1);
 
     /**
-     * Goertzel algorithm implementation for single frequency detection
-     * Used to detect specific audio frequencies in the AFSK demodulation process
+     * Goertzel filter bank for the mark and space frequencies, run on blocks of up to kWindowSize samples
+     * With the block as long as the window, the Goertzel output is the DFT at the target frequency, so both
+     * tones come out of one pass of Q15 correlations; on the ESP32-S3 these are esp-dsp dot products
      */
-    class FrequencyDetector
+    class GoertzelBank
     {
     private:
-        float frequency_;              // Target frequency (normalized, i.e., f / fs)
-        size_t window_size_;           // Window size for analysis
-        float frequency_bin_;          // Frequency bin
-        float angular_frequency_;      // Angular frequency
-        float cos_coefficient_;        // cos(w)
-        float sin_coefficient_;        // sin(w)
-        float filter_coefficient_;     // 2 * cos(w)
-        std::deque<float> state_buffer_;  // Circular buffer for storing S[-1] and S[-2]
+        alignas(16) std::array<int16_t, kWindowSize> mark_cos_;     // Q15 cos(w * n) of the mark frequency
+        alignas(16) std::array<int16_t, kWindowSize> mark_sin_;
+        alignas(16) std::array<int16_t, kWindowSize> space_cos_;
+        alignas(16) std::array<int16_t, kWindowSize> space_sin_;
+        alignas(16) std::array<int16_t, kWindowSize> scaled_;      // Block scaled into the correlation headroom
 
     public:
         /**
          * Constructor
-         * @param frequency Normalized frequency (f / fs)
-         * @param window_size Window size for analysis
-         */
-        FrequencyDetector(float frequency, size_t window_size);
-
-        /**
-         * Reset the detector state
-         */
-        void Reset();
-
-        /**
-         * Process one audio sample
-         * @param sample Input audio sample
+         * @param sample_rate Audio sampling rate
+         * @param mark_frequency Mark frequency for digital '1'
+         * @param space_frequency Space frequency for digital '0'
          */
-        void ProcessSample(float sample);
+        GoertzelBank(size_t sample_rate, size_t mark_frequency, size_t space_frequency);
 
         /**
-         * Calculate current amplitude
-         * @return Amplitude value
+         * Process one block of samples
+         * @param block Input audio samples
+         * @param samples Block length, at most kWindowSize
+         * @return Mark probability, mark amplitude / (mark + space amplitude)
          */
-        float GetAmplitude() const;
+        float ProcessBlock(const int16_t *block, size_t samples);
     };
 
     /**
      * Audio signal processor for Mark/Space frequency pair detection
-     * Processes audio signals to extract digital data using AFSK demodulation
+     * Decimates the input to the analysis rate and keeps the current window in a fixed array,
+     * so processing allocates nothing
      */
     class AudioSignalProcessor
     {
     private:
-        std::deque<float> input_buffer_;             // Input sample buffer
-        size_t input_buffer_size_;                   // Input buffer size = window size
-        size_t output_sample_count_;                 // Output sample counter
-        size_t samples_per_bit_;                     // Samples per bit threshold
-        std::unique_ptr<FrequencyDetector> mark_detector_;   // Mark frequency detector
-        std::unique_ptr<FrequencyDetector> space_detector_;  // Space frequency detector
+        GoertzelBank goertzel_bank_;                 // Mark and space detectors
+        std::array<int16_t, kWindowSize> window_;    // Last samples of the current bit
+        size_t window_size_;                         // Analysis window size, at most kWindowSize
+        size_t samples_per_bit_;                     // Samples per bit at the analysis rate
+        size_t bit_sample_count_;                    // Samples of the current bit seen so far
+        int input_sample_rate_;                      // Rate of the samples passed in
+        int sample_rate_;                            // Analysis rate
+        int decimation_phase_;                       // Picks the input sample for each analysis sample
 
     public:
         /**
          * Constructor
-         * @param sample_rate Audio sampling rate
+         * @param input_sample_rate Rate of the samples passed to ProcessAudioSamples, at least sample_rate
+         * @param sample_rate Audio sampling rate of the analysis
          * @param mark_frequency Mark frequency for digital '1'
          * @param space_frequency Space frequency for digital '0'
          * @param bit_rate Data transmission bit rate
-         * @param window_size Analysis window size
+         * @param window_size Analysis window size, at most kWindowSize and one bit
          */
-        AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
-                           size_t bit_rate, size_t window_size);
+        AudioSignalProcessor(size_t input_sample_rate, size_t sample_rate, size_t mark_frequency,
+                           size_t space_frequency, size_t bit_rate, size_t window_size);
 
         /**
          * Process input audio samples
-         * @param samples Input audio sample vector
-         * @return Vector of Mark probability values (0.0 to 1.0)
+         * @param samples Input audio samples at the input rate
+         * @param count Number of samples
+         * @param probabilities Receives one Mark probability (0.0 to 1.0) per completed bit
+         * @param max_probabilities Room in probabilities, bits past it are dropped
+         * @return Number of probabilities written
          */
-        std::vector<float> ProcessAudioSamples(const std::vector<float> &samples);
+        size_t ProcessAudioSamples(const int16_t *samples, size_t count, float *probabilities, size_t max_probabilities);
+
+        /**
+         * Upper bound of the probabilities one call with `count` samples returns
+         */
+        size_t GetMaxProbabilities(size_t count) const;
     };
 
     /**
@@ -116,12 +120,15 @@ namespace audio_wifi_config
     {
     private:
         DataReceptionState current_state_;       // Current reception state
-        std::deque<uint8_t> identifier_buffer_;  // Buffer for start/end identifier detection
+        uint64_t identifier_bits_;               // Last received bits, newest in bit 0
+        size_t identifier_bit_count_;            // Bits received since the last clear, up to identifier_buffer_size_
         size_t identifier_buffer_size_;          // Identifier buffer size
         std::vector<uint8_t> bit_buffer_;        // Buffer for storing bit stream
         size_t max_bit_buffer_size_;             // Maximum bit buffer size
         const std::vector<uint8_t> start_of_transmission_;  // Start-of-transmission identifier
         const std::vector<uint8_t> end_of_transmission_;    // End-of-transmission identifier
+        uint64_t start_bits_;                    // Start identifier packed like identifier_bits_
+        uint64_t end_bits_;                      // End identifier packed like identifier_bits_
         bool enable_checksum_validation_;       // Whether to validate checksum
 
     public:
@@ -135,8 +142,8 @@ namespace audio_wifi_config
         /**
          * Constructor with custom parameters
          * @param max_byte_size Expected maximum data size in bytes
-         * @param start_identifier Start-of-transmission identifier
-         * @param end_identifier End-of-transmission identifier
+         * @param start_identifier Start-of-transmission identifier, at most 64 bits
+         * @param end_identifier End-of-transmission identifier, at most 64 bits
          * @param enable_checksum Whether to enable checksum validation
          */
         AudioDataBuffer(size_t max_byte_size, const std::vector<uint8_t> &start_identifier,
@@ -144,11 +151,12 @@ namespace audio_wifi_config
 
         /**
          * Process probability data and attempt to decode
-         * @param probabilities Vector of Mark probabilities
+         * @param probabilities Mark probabilities
+         * @param count Number of probabilities
          * @param threshold Decision threshold for bit detection
          * @return true if complete data was successfully received and decoded
          */
-        bool ProcessProbabilityData(const std::vector<float> &probabilities, float threshold = 0.5f);
+        bool ProcessProbabilityData(const float *probabilities, size_t count, float threshold = 0.5f);
 
         /**
          * Calculate checksum for ASCII text
@@ -158,6 +166,18 @@ namespace audio_wifi_config
         static uint8_t CalculateChecksum(const std::string &text);
 
     private:
+        /**
+         * Whether the last received bits match an identifier
+         * @param identifier Identifier bits
+         * @param packed Identifier packed like identifier_bits_
+         */
+        bool MatchIdentifier(const std::vector<uint8_t> &identifier, uint64_t packed) const;
+
+        /**
+         * Pack identifier bits, newest in bit 0
+         */
+        static uint64_t PackIdentifier(const std::vector<uint8_t> &identifier);
+
         /**
          * Convert bit vector to byte vector
          * @param bits Input bit vector
@@ -174,4 +194,4 @@ namespace audio_wifi_config
     // Default start and end transmission identifiers
     extern const std::vector<uint8_t> kDefaultStartTransmissionPattern;
     extern const std::vector<uint8_t> kDefaultEndTransmissionPattern;
-}
\ No newline at end of file
+}
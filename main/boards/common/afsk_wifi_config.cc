@@ -0,0 +1,82 @@
+#include "afsk_demod.h"
+#include "application.h"
+#include "display.h"
+#include "wifi_configuration_ap.h"
+#include "audio_kernels.h"
+#include "esp_log.h"
+
+namespace audio_wifi_config
+{
+    static const char *kLogTag = "AUDIO_WIFI_CONFIG";
+
+    void ReceiveWifiCredentialsFromAudio(Application *app,
+                                        WifiConfigurationAp *wifi_ap,
+                                        Display *display,
+                                        size_t input_channels
+                                    )
+    {
+        const int kInputSampleRate = 16000;                                    // Input sampling rate
+        const int kInputSamples = 480;                                         // 30ms per read
+        std::vector<int16_t> audio_data;
+        AudioSignalProcessor signal_processor(kInputSampleRate, kAudioSampleRate, kMarkFrequency, kSpaceFrequency,
+                                              kBitRate, kWindowSize);
+        AudioDataBuffer data_buffer;
+        std::vector<float> probabilities(signal_processor.GetMaxProbabilities(kInputSamples));
+
+        while (true)
+        {
+            // 检查Application状态，只有在WiFi配置模式下才处理音频
+            if (app->GetDeviceState() != kDeviceStateWifiConfiguring) {
+                // 不在WiFi配置状态，休眠100ms后再检查
+                vTaskDelay(pdMS_TO_TICKS(100));
+                continue;
+            }
+
+            if (!app->GetAudioService().ReadAudioData(audio_data, kInputSampleRate, kInputSamples)) {
+                // 读取音频失败，短暂延迟后重试
+                ESP_LOGI(kLogTag, "Failed to read audio data, retrying.");
+                vTaskDelay(pdMS_TO_TICKS(10));
+                continue;
+            }
+
+            if (input_channels == 2) { // 如果是双声道输入，转换为单声道
+                audio_extract_channel_s16(audio_data.data(), audio_data.data(), audio_data.size() / 2, 2, 0);
+                audio_data.resize(audio_data.size() / 2);
+            }
+
+            // Downsample and process audio samples to get probability data
+            size_t count = signal_processor.ProcessAudioSamples(audio_data.data(), audio_data.size(),
+                                                                probabilities.data(), probabilities.size());
+
+            // Feed probability data to the data buffer
+            if (data_buffer.ProcessProbabilityData(probabilities.data(), count, 0.5f)) {
+                // If complete data was received, extract WiFi credentials
+                if (data_buffer.decoded_text.has_value()) {
+                    ESP_LOGI(kLogTag, "Received text data: %s", data_buffer.decoded_text->c_str());
+                    display->SetChatMessage("system", data_buffer.decoded_text->c_str());
+
+                    // Split SSID and password by newline character
+                    std::string wifi_ssid, wifi_password;
+                    size_t newline_position = data_buffer.decoded_text->find('\n');
+                    if (newline_position != std::string::npos) {
+                        wifi_ssid = data_buffer.decoded_text->substr(0, newline_position);
+                        wifi_password = data_buffer.decoded_text->substr(newline_position + 1);
+                        ESP_LOGI(kLogTag, "WiFi SSID: %s, Password: %s", wifi_ssid.c_str(), wifi_password.c_str());
+                    } else {
+                        ESP_LOGE(kLogTag, "Invalid data format, no newline character found");
+                        continue;
+                    }
+
+                    if (wifi_ap->ConnectToWifi(wifi_ssid, wifi_password)) {
+                        wifi_ap->Save(wifi_ssid, wifi_password);  // Save WiFi credentials
+                        esp_restart();                            // Restart device to apply new WiFi configuration
+                    } else {
+                        ESP_LOGE(kLogTag, "Failed to connect to WiFi with received credentials");
+                    }
+                    data_buffer.decoded_text.reset();  // Clear processed data
+                }
+            }
+            vTaskDelay(pdMS_TO_TICKS(1));  // 1ms delay
+        }
+    }
+}
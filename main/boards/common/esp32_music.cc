@@ -277,13 +277,6 @@ bool Esp32Music::StartStreaming(const std::string& music_url) {
         return false;
     }
     
-    // Enable audio output
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (codec && !codec->output_enabled()) {
-        ESP_LOGI(TAG, "🔊 Enabling audio output");
-        codec->EnableOutput(true);
-    }
-    
     // Set state flags
     current_music_url_ = music_url;
     is_downloading_ = true;
@@ -467,17 +460,8 @@ void Esp32Music::DownloadAudioStream(const std::string& music_url) {
 void Esp32Music::PlayAudioStream() {
     ESP_LOGI(TAG, "Play thread started");
     
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (!codec) {
-        ESP_LOGE(TAG, "Audio codec not available");
-        is_playing_ = false;
-        return;
-    }
-    
-    // Enable speaker output
-    if (!codec->output_enabled()) {
-        codec->EnableOutput(true);
-    }
+    // The audio service mixes music with speech and UI sounds, and powers the speaker on demand
+    auto& audio_service = Application::GetInstance().GetAudioService();
     
     // Wait for minimum buffer before starting
     {
@@ -618,10 +602,11 @@ void Esp32Music::PlayAudioStream() {
                 continue;
             }
             
-            // Play PCM data through codec
+            // Queue PCM data on the music stream
             int sample_count = mp3_frame_info_.outputSamps;
-            std::vector<int16_t> pcm_data(pcm_buffer, pcm_buffer + sample_count);
-            codec->OutputData(pcm_data);
+            if (!audio_service.WriteMusicData(pcm_buffer, sample_count, mp3_frame_info_.samprate, mp3_frame_info_.nChans)) {
+                break;
+            }
             
             total_played += sample_count * sizeof(int16_t);
             
@@ -710,6 +695,7 @@ bool Esp32Music::Stop() {
     
     // Clear buffer and free memory
     ClearAudioBuffer();
+    Application::GetInstance().GetAudioService().ClearMusic();
     
     // Reset stopping flag
     is_stopping_.store(false, std::memory_order_release);
@@ -1,4 +1,5 @@
 #include "tcamerapluss3_audio_codec.h"
+#include "audio_kernels.h"
 
 #include <esp_log.h>
 #include <driver/i2c_master.h>
@@ -146,11 +147,7 @@ int Tcamerapluss3AudioCodec::Read(int16_t *dest, int samples) {
         i2s_channel_read(rx_handle_, dest, samples * sizeof(int16_t), &bytes_read, portMAX_DELAY);
         
         // 麦克风接收音量放大20倍（限制在 int16_t 范围内防止溢出）
-        int16_t *ptr = dest;
-        for (int i = 0; i < samples; i++) {
-            int32_t amplified = *ptr * 20;
-            *ptr++ = (amplified > 32767) ? 32767 : (amplified < -32768) ? -32768 : amplified;
-        }
+        audio_scale_s16(dest, dest, samples, 20 * 65536);
     }
     return samples;
 }
@@ -159,9 +156,7 @@ int Tcamerapluss3AudioCodec::Write(const int16_t *data, int samples){
     if (output_enabled_){
         size_t bytes_read;
         auto output_data = (int16_t *)malloc(samples * sizeof(int16_t));
-        for (size_t i = 0; i < samples; i++){
-            output_data[i] = (float)data[i] * (float)(volume_ / 100.0);
-        }
+        audio_scale_s16(data, output_data, samples, volume_ * 65536 / 100);
         i2s_channel_write(tx_handle_, output_data, samples * sizeof(int16_t), &bytes_read, portMAX_DELAY);
         free(output_data);
     }
@@ -204,6 +204,20 @@ void McpServer::AddUserOnlyTools() {
             return board.GetSystemInfoJson();
         });
 
+    AddUserOnlyTool("self.audio.get_latency_stats",
+        "Get the per-stage audio latency histograms (capture, encode, send, uplink, decode, playback, downlink)",
+        PropertyList({
+            Property("reset", kPropertyTypeBoolean, false)
+        }),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto& tracer = AudioLatencyTracer::GetInstance();
+            auto json = tracer.GetStatsJson();
+            if (properties["reset"].value<bool>()) {
+                tracer.Reset();
+            }
+            return json;
+        });
+
     AddUserOnlyTool("self.reboot", "Reboot the system",
         PropertyList(),
         [this](const PropertyList& properties) -> ReturnValue {
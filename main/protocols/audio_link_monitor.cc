@@ -0,0 +1,101 @@
+#include "audio_link_monitor.h"
+
+#include <cstdlib>
+
+void AudioLinkMonitor::Reset(int frame_duration_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame_duration_ms > 0) {
+        frame_duration_ms_ = frame_duration_ms;
+    }
+    started_ = false;
+    received_ = 0;
+    reordered_ = 0;
+    duplicates_ = 0;
+    expected_prior_ = 0;
+    received_prior_ = 0;
+    has_transit_ = false;
+    jitter_us_ = 0;
+}
+
+void AudioLinkMonitor::Start(uint32_t sequence) {
+    started_ = true;
+    base_sequence_ = sequence;
+    max_sequence_ = sequence;
+    bad_sequence_ = sequence - 1;
+    window_ = 1;
+    received_ = 1;
+    expected_prior_ = 0;
+    received_prior_ = 0;
+    has_transit_ = false;
+}
+
+void AudioLinkMonitor::UpdateJitter(uint32_t sequence, int64_t arrival_us) {
+    // |D| as in RFC 3550 A.8, early and late arrivals both count. AudioJitterBuffer keeps its own late-only
+    // estimate for sizing the playout delay
+    int64_t transit = arrival_us - static_cast<int64_t>(sequence) * frame_duration_ms_ * 1000;
+    if (has_transit_) {
+        int64_t d = std::llabs(transit - last_transit_us_);
+        jitter_us_ += (d - jitter_us_) / 16;
+    }
+    last_transit_us_ = transit;
+    has_transit_ = true;
+}
+
+bool AudioLinkMonitor::OnPacket(uint32_t sequence, int64_t arrival_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) {
+        Start(sequence);
+        UpdateJitter(sequence, arrival_us);
+        return true;
+    }
+
+    int32_t delta = static_cast<int32_t>(sequence - max_sequence_);
+    if (delta > 0 && delta < AUDIO_LINK_MAX_DROPOUT) {
+        window_ = delta < AUDIO_LINK_DUPLICATE_WINDOW ? (window_ << delta) | 1 : 1;
+        max_sequence_ = sequence;
+    } else if (delta <= 0 && -delta <= AUDIO_LINK_MAX_MISORDER) {
+        if (-delta < AUDIO_LINK_DUPLICATE_WINDOW) {
+            uint64_t bit = 1ULL << -delta;
+            if (window_ & bit) {
+                duplicates_++;
+                return false;
+            }
+            window_ |= bit;
+        }
+        if (static_cast<int32_t>(sequence - base_sequence_) < 0) {
+            // Overtaken by the first packet, it belongs to the expected range as well
+            base_sequence_ = sequence;
+        }
+        reordered_++;
+    } else if (sequence == bad_sequence_) {
+        // Two sequential packets far from the old stream, the sender restarted its numbering
+        Start(sequence);
+        UpdateJitter(sequence, arrival_us);
+        return true;
+    } else {
+        bad_sequence_ = sequence + 1;
+        return false;
+    }
+
+    received_++;
+    UpdateJitter(sequence, arrival_us);
+    return true;
+}
+
+void AudioLinkMonitor::Report(AudioLinkQuality& quality) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t expected = started_ ? max_sequence_ - base_sequence_ + 1 : 0;
+    quality.received = received_;
+    quality.expected = expected;
+    quality.lost = expected > received_ ? expected - received_ : 0;
+    quality.reordered = reordered_;
+    quality.duplicates = duplicates_;
+    quality.jitter_ms = jitter_us_ / 1000;
+
+    uint32_t expected_interval = expected - expected_prior_;
+    uint32_t received_interval = received_ - received_prior_;
+    expected_prior_ = expected;
+    received_prior_ = received_;
+    quality.loss_percent = expected_interval > received_interval
+        ? (expected_interval - received_interval) * 100 / expected_interval : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef AUDIO_LINK_MONITOR_H
+#define AUDIO_LINK_MONITOR_H
+
+#include "protocol.h"
+
+#include <cstdint>
+#include <mutex>
+
+// A jump ahead of the highest sequence larger than this, or back by more than AUDIO_LINK_MAX_MISORDER, is a
+// restarted stream once a second packet confirms it (RFC 3550 A.1)
+#define AUDIO_LINK_MAX_DROPOUT 3000
+#define AUDIO_LINK_MAX_MISORDER 100
+// Sequence numbers behind the highest one that are remembered for duplicate detection
+#define AUDIO_LINK_DUPLICATE_WINDOW 64
+
+/*
+ * Receive side bookkeeping of a sequenced audio stream after RFC 3550 A.1, A.3 and A.8: packets received,
+ * expected and lost, reordered and duplicated packets, and the interarrival jitter with the sequence number
+ * as media clock. Everything is counted, nothing is logged, so a lossy link costs no more than a clean one.
+ *
+ * OnPacket() runs on the transport's receive task, Report() on whoever polls the link quality.
+ */
+class AudioLinkMonitor {
+public:
+    AudioLinkMonitor() = default;
+
+    // Forgets the stream, e.g. for a new session with sequences starting over
+    void Reset(int frame_duration_ms);
+    // False for duplicates and for packets outside the stream, which should be dropped
+    bool OnPacket(uint32_t sequence, int64_t arrival_us);
+    // Totals since Reset(), fraction_lost since the previous report
+    void Report(AudioLinkQuality& quality);
+
+private:
+    std::mutex mutex_;
+    int frame_duration_ms_ = 60;
+    bool started_ = false;
+    uint32_t base_sequence_ = 0;
+    uint32_t max_sequence_ = 0;
+    uint32_t bad_sequence_ = 0;
+    uint64_t window_ = 0;  // Bit n set: max_sequence_ - n was received
+
+    uint32_t received_ = 0;
+    uint32_t reordered_ = 0;
+    uint32_t duplicates_ = 0;
+    uint32_t expected_prior_ = 0;
+    uint32_t received_prior_ = 0;
+
+    bool has_transit_ = false;
+    int64_t last_transit_us_ = 0;
+    int64_t jitter_us_ = 0;
+
+    void Start(uint32_t sequence);
+    void UpdateJitter(uint32_t sequence, int64_t arrival_us);
+};
+
+#endif // AUDIO_LINK_MONITOR_H
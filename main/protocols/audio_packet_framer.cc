@@ -0,0 +1,100 @@
+#include "audio_packet_framer.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+
+AudioPacketFramer::AudioPacketFramer() {
+    frame_.reserve(AUDIO_PACKET_MAX_BATCH_BYTES);
+}
+
+size_t AudioPacketFramer::HeaderSize(int version) {
+    if (version == 2) {
+        return sizeof(BinaryProtocol2);
+    } else if (version == 3) {
+        return sizeof(BinaryProtocol3);
+    }
+    return 0;
+}
+
+const uint8_t* AudioPacketFramer::Serialize(int version, const AudioStreamPacket& packet, size_t& size) {
+    size_t header_size = HeaderSize(version);
+    if (header_size == 0) {
+        // Version 1 sends the Opus packet as it is
+        size = packet.payload.size();
+        return packet.payload.data();
+    }
+
+    // Within the reserved capacity this only moves the end, nothing is allocated or zero filled
+    size = header_size + packet.payload.size();
+    frame_.resize(size);
+    WriteHeader(version, BINARY_PROTOCOL_TYPE_OPUS, packet.timestamp, packet.payload.size());
+    memcpy(frame_.data() + header_size, packet.payload.data(), packet.payload.size());
+    return frame_.data();
+}
+
+const uint8_t* AudioPacketFramer::SerializeBatch(int version, const AudioStreamPacket* const* packets, size_t count,
+    size_t& size) {
+    size_t header_size = HeaderSize(version);
+    if (header_size == 0 || count == 0 || count > AUDIO_BATCH_MAX_FRAMES) {
+        return nullptr;
+    }
+
+    size_t payload_size = 1 + 2 * count;
+    for (size_t i = 0; i < count; i++) {
+        payload_size += packets[i]->payload.size();
+    }
+    size = header_size + payload_size;
+    frame_.resize(size);
+    WriteHeader(version, BINARY_PROTOCOL_TYPE_OPUS_BATCH, packets[0]->timestamp, payload_size);
+
+    uint8_t* table = frame_.data() + header_size;
+    uint8_t* data = table + 1 + 2 * count;
+    table[0] = count;
+    for (size_t i = 0; i < count; i++) {
+        auto& payload = packets[i]->payload;
+        table[1 + 2 * i] = payload.size() >> 8;
+        table[2 + 2 * i] = payload.size() & 0xFF;
+        memcpy(data, payload.data(), payload.size());
+        data += payload.size();
+    }
+    return frame_.data();
+}
+
+void AudioPacketFramer::WriteHeader(int version, uint8_t type, uint32_t timestamp, size_t payload_size) {
+    if (version == 2) {
+        auto bp2 = (BinaryProtocol2*)frame_.data();
+        bp2->version = htons(version);
+        bp2->type = htons(type);
+        bp2->reserved = 0;
+        bp2->timestamp = htonl(timestamp);
+        bp2->payload_size = htonl(payload_size);
+    } else {
+        auto bp3 = (BinaryProtocol3*)frame_.data();
+        bp3->type = type;
+        bp3->reserved = 0;
+        bp3->payload_size = htons(payload_size);
+    }
+}
+
+bool AudioPacketFramer::Deserialize(int version, const uint8_t* data, size_t size, AudioStreamPacket& packet) const {
+    size_t header_size = HeaderSize(version);
+    if (size < header_size) {
+        return false;
+    }
+
+    size_t payload_size = size;
+    packet.timestamp = 0;
+    if (version == 2) {
+        auto bp2 = (const BinaryProtocol2*)data;
+        packet.timestamp = ntohl(bp2->timestamp);
+        payload_size = ntohl(bp2->payload_size);
+    } else if (version == 3) {
+        auto bp3 = (const BinaryProtocol3*)data;
+        payload_size = ntohs(bp3->payload_size);
+    }
+    if (payload_size > size - header_size) {
+        return false;
+    }
+    packet.payload.assign(data + header_size, data + header_size + payload_size);
+    return true;
+}
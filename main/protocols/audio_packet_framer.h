@@ -0,0 +1,42 @@
+#ifndef AUDIO_PACKET_FRAMER_H
+#define AUDIO_PACKET_FRAMER_H
+
+#include "protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The largest batch frame: header, count byte, a 2 byte size per packet and the largest Opus packets (RFC 6716),
+// which also covers any single frame
+#define AUDIO_PACKET_MAX_BATCH_BYTES (sizeof(BinaryProtocol2) + 1 + AUDIO_BATCH_MAX_FRAMES * (2 + 1275))
+
+/*
+ * Binary framing of Opus packets on the websocket, BinaryProtocol2 / BinaryProtocol3 headers or the bare
+ * payload for version 1.
+ *
+ * Outgoing frames are built in one buffer reserved for the largest batch frame, so framing never touches
+ * the heap. Incoming frames are read in place, without byte swapping the receive buffer, and their payload
+ * goes straight into the packet passed in, normally a pooled one.
+ */
+class AudioPacketFramer {
+public:
+    AudioPacketFramer();
+
+    // Frame of `packet` for protocol `version`, valid until the next call
+    const uint8_t* Serialize(int version, const AudioStreamPacket& packet, size_t& size);
+    // One BINARY_PROTOCOL_TYPE_OPUS_BATCH frame of up to AUDIO_BATCH_MAX_FRAMES packets, with the timestamp of
+    // the first; versions 2 and 3 only, nullptr otherwise
+    const uint8_t* SerializeBatch(int version, const AudioStreamPacket* const* packets, size_t count, size_t& size);
+    // Fills the timestamp and payload of `packet`, false if the frame is shorter than its header says
+    bool Deserialize(int version, const uint8_t* data, size_t size, AudioStreamPacket& packet) const;
+
+    static size_t HeaderSize(int version);
+
+private:
+    std::vector<uint8_t> frame_;
+
+    void WriteHeader(int version, uint8_t type, uint32_t timestamp, size_t payload_size);
+};
+
+#endif // AUDIO_PACKET_FRAMER_H
@@ -3,10 +3,11 @@
 
 
 #include "protocol.h"
+#include "udp_audio_cipher.h"
+#include "audio_link_monitor.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
-#include <mbedtls/aes.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <esp_timer.h>
@@ -27,7 +28,10 @@ public:
     ~MqttProtocol();
 
     bool Start() override;
-    bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) override;
+    bool SendAudio(const AudioStreamPacket& packet) override;
+    bool SendAudioBatch(const AudioStreamPacket* const* packets, size_t count) override;
+    size_t GetAudioBatchLimit() const override { return AUDIO_BATCH_MAX_FRAMES; }
+    bool GetAudioLinkQuality(AudioLinkQuality& quality) override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
@@ -40,12 +44,11 @@ private:
     std::mutex channel_mutex_;
     std::unique_ptr<Mqtt> mqtt_;
     std::unique_ptr<Udp> udp_;
-    mbedtls_aes_context aes_ctx_;
-    std::string aes_nonce_;
+    UdpAudioCipher cipher_;
     std::string udp_server_;
     int udp_port_;
     uint32_t local_sequence_;
-    uint32_t remote_sequence_;
+    AudioLinkMonitor link_monitor_;
     esp_timer_handle_t reconnect_timer_;
     bool goodbye_action_queued_ = false;  // Track if goodbye sit action already queued
 
@@ -54,6 +57,7 @@ private:
     std::string DecodeHexString(const std::string& hex_string);
 
     bool SendText(const std::string& text) override;
+    bool SendAudioLocked(const AudioStreamPacket& packet);
     std::string GetHelloMessage();
 };
 
@@ -32,6 +32,73 @@ void Protocol::OnDisconnected(std::function<void()> callback) {
     on_disconnected_ = callback;
 }
 
+void Protocol::SetPreferredFrameDuration(int frame_duration) {
+    if (frame_duration != 20 && frame_duration != 40 && frame_duration != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration: %d", frame_duration);
+        return;
+    }
+    preferred_frame_duration_ = frame_duration;
+}
+
+void Protocol::SetAudioPacketAllocator(std::function<std::unique_ptr<AudioStreamPacket>()> allocator) {
+    audio_packet_allocator_ = allocator;
+}
+
+void Protocol::SetAudioPacketRecycler(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> recycler) {
+    audio_packet_recycler_ = recycler;
+}
+
+std::unique_ptr<AudioStreamPacket> Protocol::AllocateAudioPacket() {
+    if (audio_packet_allocator_ != nullptr) {
+        return audio_packet_allocator_();
+    }
+    return std::make_unique<AudioStreamPacket>();
+}
+
+void Protocol::RecycleAudioPacket(std::unique_ptr<AudioStreamPacket> packet) {
+    if (audio_packet_recycler_ != nullptr) {
+        audio_packet_recycler_(std::move(packet));
+    }
+}
+
+bool Protocol::SendAudioBatch(const AudioStreamPacket* const* packets, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!SendAudio(*packets[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Protocol::ParseAudioParams(const cJSON* audio_params) {
+    if (cJSON_IsObject(audio_params)) {
+        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
+        if (cJSON_IsNumber(sample_rate)) {
+            server_sample_rate_ = sample_rate->valueint;
+        }
+        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
+        if (cJSON_IsNumber(frame_duration)) {
+            server_frame_duration_ = frame_duration->valueint;
+        }
+    }
+
+    // frame_duration above is the server's downlink. The uplink duration the server accepted comes back in
+    // its own field; servers that do not know it expect the fixed 60 ms.
+    uplink_frame_duration_ = 60;
+    auto uplink_frame_duration = cJSON_IsObject(audio_params) ?
+        cJSON_GetObjectItem(audio_params, "uplink_frame_duration") : nullptr;
+    if (cJSON_IsNumber(uplink_frame_duration)) {
+        int duration = uplink_frame_duration->valueint;
+        if (duration == 20 || duration == 40 || duration == 60) {
+            uplink_frame_duration_ = duration;
+        } else {
+            ESP_LOGW(TAG, "Unsupported uplink frame duration: %d", duration);
+        }
+    }
+    ESP_LOGI(TAG, "Frame duration: uplink %d ms (requested %d ms), downlink %d ms", uplink_frame_duration_,
+        preferred_frame_duration_, server_frame_duration_);
+}
+
 void Protocol::SetError(const std::string& message) {
     error_occurred_ = true;
     if (on_network_error_ != nullptr) {
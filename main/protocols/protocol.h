@@ -4,6 +4,7 @@
 #include <cJSON.h>
 #include <string>
 #include <functional>
+#include <memory>
 #include <chrono>
 #include <vector>
 
@@ -12,11 +13,25 @@ struct AudioStreamPacket {
     int frame_duration = 0;
     uint32_t timestamp = 0;
     std::vector<uint8_t> payload;
+    uint32_t sequence = 0;      // Transport sequence number, only valid with has_sequence
+    bool has_sequence = false;  // The transport numbers its packets, 0 included
+    // Local latency tracing stamps (esp_timer microseconds), never sent on the wire
+    int64_t origin_time_us = 0;
+    int64_t stage_time_us = 0;
 };
 
+// Frames one batched audio message may carry, see Protocol::SendAudioBatch()
+#define AUDIO_BATCH_MAX_FRAMES 8
+
+// Message types of BinaryProtocol2 / BinaryProtocol3
+#define BINARY_PROTOCOL_TYPE_OPUS 0
+#define BINARY_PROTOCOL_TYPE_JSON 1
+// Several Opus frames: a frame count byte, a big endian uint16 length per frame, then the frames
+#define BINARY_PROTOCOL_TYPE_OPUS_BATCH 2
+
 struct BinaryProtocol2 {
     uint16_t version;
-    uint16_t type;          // Message type (0: OPUS, 1: JSON)
+    uint16_t type;          // Message type (BINARY_PROTOCOL_TYPE_*)
     uint32_t reserved;      // Reserved for future use
     uint32_t timestamp;     // Timestamp in milliseconds (used for server-side AEC)
     uint32_t payload_size;  // Payload size in bytes
@@ -30,6 +45,17 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+// Downlink statistics of a transport with sequence numbers, see Protocol::GetAudioLinkQuality()
+struct AudioLinkQuality {
+    uint32_t received = 0;      // Packets received this session, duplicates excluded
+    uint32_t expected = 0;      // Highest sequence received minus the first, plus one
+    uint32_t lost = 0;          // Expected but never received
+    uint32_t reordered = 0;     // Received after a packet with a higher sequence
+    uint32_t duplicates = 0;
+    uint32_t jitter_ms = 0;     // RFC 3550 interarrival jitter
+    uint32_t loss_percent = 0;  // Lost since the previous query
+};
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -51,6 +77,9 @@ public:
     inline int server_frame_duration() const {
         return server_frame_duration_;
     }
+    inline int uplink_frame_duration() const {
+        return uplink_frame_duration_;
+    }
     inline const std::string& session_id() const {
         return session_id_;
     }
@@ -62,12 +91,23 @@ public:
     void OnNetworkError(std::function<void(const std::string& message)> callback);
     void OnConnected(std::function<void()> callback);
     void OnDisconnected(std::function<void()> callback);
+    // Uplink frame duration (20, 40 or 60 ms) requested in the next hello message
+    void SetPreferredFrameDuration(int frame_duration);
+    // Source of the packets passed to OnIncomingAudio, normally a pool that takes them back after decoding
+    void SetAudioPacketAllocator(std::function<std::unique_ptr<AudioStreamPacket>()> allocator);
+    // Takes back the allocated packets that are dropped before reaching OnIncomingAudio
+    void SetAudioPacketRecycler(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> recycler);
 
     virtual bool Start() = 0;
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
+    virtual bool SendAudio(const AudioStreamPacket& packet) = 0;
+    // Sends up to GetAudioBatchLimit() frames as one message where the server accepts it, one by one otherwise
+    virtual bool SendAudioBatch(const AudioStreamPacket* const* packets, size_t count);
+    virtual size_t GetAudioBatchLimit() const { return 1; }
+    // Fills `quality` and starts a new loss interval; false if the transport does not number its audio packets
+    virtual bool GetAudioLinkQuality(AudioLinkQuality& quality) { return false; }
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -83,9 +123,13 @@ protected:
     std::function<void(const std::string& message)> on_network_error_;
     std::function<void()> on_connected_;
     std::function<void()> on_disconnected_;
+    std::function<std::unique_ptr<AudioStreamPacket>()> audio_packet_allocator_;
+    std::function<void(std::unique_ptr<AudioStreamPacket> packet)> audio_packet_recycler_;
 
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
+    int preferred_frame_duration_ = 60;
+    int uplink_frame_duration_ = 60;
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
@@ -93,6 +137,9 @@ protected:
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
+    void ParseAudioParams(const cJSON* audio_params);
+    std::unique_ptr<AudioStreamPacket> AllocateAudioPacket();
+    void RecycleAudioPacket(std::unique_ptr<AudioStreamPacket> packet);
 };
 
 #endif // PROTOCOL_H
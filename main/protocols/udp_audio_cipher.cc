@@ -0,0 +1,61 @@
+#include "udp_audio_cipher.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+
+UdpAudioCipher::UdpAudioCipher() {
+    mbedtls_aes_init(&aes_ctx_);
+    datagram_.reserve(UDP_AUDIO_MAX_DATAGRAM_BYTES);
+}
+
+UdpAudioCipher::~UdpAudioCipher() {
+    mbedtls_aes_free(&aes_ctx_);
+}
+
+bool UdpAudioCipher::SetKey(const std::string& key, const std::string& nonce) {
+    if (key.size() != 16 || nonce.size() != UDP_AUDIO_HEADER_SIZE) {
+        return false;
+    }
+    memcpy(nonce_, nonce.data(), UDP_AUDIO_HEADER_SIZE);
+    return mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)key.data(), 128) == 0;
+}
+
+const std::string* UdpAudioCipher::Encrypt(const AudioStreamPacket& packet, uint32_t sequence) {
+    // Within the reserved capacity this only moves the end
+    datagram_.resize(UDP_AUDIO_HEADER_SIZE + packet.payload.size());
+    auto header = (uint8_t*)datagram_.data();
+    memcpy(header, nonce_, UDP_AUDIO_HEADER_SIZE);
+    *(uint16_t*)&header[2] = htons(packet.payload.size());
+    *(uint32_t*)&header[8] = htonl(packet.timestamp);
+    *(uint32_t*)&header[12] = htonl(sequence);
+
+    // CTR mode regenerates the stream block from the counter at offset 0, it needs no clearing
+    uint8_t counter[UDP_AUDIO_HEADER_SIZE];
+    uint8_t stream_block[16];
+    size_t nc_off = 0;
+    memcpy(counter, header, UDP_AUDIO_HEADER_SIZE);
+    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet.payload.size(), &nc_off, counter, stream_block,
+        packet.payload.data(), header + UDP_AUDIO_HEADER_SIZE) != 0) {
+        return nullptr;
+    }
+    return &datagram_;
+}
+
+bool UdpAudioCipher::Decrypt(const std::string& datagram, AudioStreamPacket& packet) {
+    if (datagram.size() < UDP_AUDIO_HEADER_SIZE || datagram[0] != 0x01) {
+        return false;
+    }
+    auto header = (const uint8_t*)datagram.data();
+    packet.timestamp = ntohl(*(const uint32_t*)&header[8]);
+    packet.sequence = ntohl(*(const uint32_t*)&header[12]);
+    packet.has_sequence = true;
+
+    uint8_t counter[UDP_AUDIO_HEADER_SIZE];
+    uint8_t stream_block[16];
+    size_t nc_off = 0;
+    memcpy(counter, header, UDP_AUDIO_HEADER_SIZE);
+    size_t size = datagram.size() - UDP_AUDIO_HEADER_SIZE;
+    packet.payload.resize(size);
+    return mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off, counter, stream_block,
+        header + UDP_AUDIO_HEADER_SIZE, packet.payload.data()) == 0;
+}
@@ -0,0 +1,43 @@
+#ifndef UDP_AUDIO_CIPHER_H
+#define UDP_AUDIO_CIPHER_H
+
+#include "protocol.h"
+
+#include <mbedtls/aes.h>
+#include <cstdint>
+#include <string>
+
+// The packet header doubles as the AES-CTR nonce
+#define UDP_AUDIO_HEADER_SIZE 16
+#define UDP_AUDIO_MAX_DATAGRAM_BYTES (UDP_AUDIO_HEADER_SIZE + 1275)
+
+/*
+ * AES-CTR encryption of the MQTT+UDP audio packets:
+ * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|payload payload_len|
+ *
+ * The key is expanded once per session. Outgoing packets are encrypted straight behind their header in
+ * one datagram buffer reserved up front, incoming ones straight into the payload of the packet passed in,
+ * so neither direction allocates.
+ */
+class UdpAudioCipher {
+public:
+    UdpAudioCipher();
+    ~UdpAudioCipher();
+    UdpAudioCipher(const UdpAudioCipher&) = delete;
+    UdpAudioCipher& operator=(const UdpAudioCipher&) = delete;
+
+    // 16 byte key and header template from the server hello
+    bool SetKey(const std::string& key, const std::string& nonce);
+
+    // Encrypted datagram of `packet`, valid until the next call; nullptr on failure
+    const std::string* Encrypt(const AudioStreamPacket& packet, uint32_t sequence);
+    // Fills the timestamp, sequence and payload of `packet`, false if the datagram is not an audio packet
+    bool Decrypt(const std::string& datagram, AudioStreamPacket& packet);
+
+private:
+    mbedtls_aes_context aes_ctx_;
+    uint8_t nonce_[UDP_AUDIO_HEADER_SIZE] = {};
+    std::string datagram_;
+};
+
+#endif // UDP_AUDIO_CIPHER_H
@@ -3,6 +3,7 @@
 
 
 #include "protocol.h"
+#include "audio_packet_framer.h"
 
 #include <web_socket.h>
 #include <freertos/FreeRTOS.h>
@@ -16,7 +17,9 @@ public:
     ~WebsocketProtocol();
 
     bool Start() override;
-    bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) override;
+    bool SendAudio(const AudioStreamPacket& packet) override;
+    bool SendAudioBatch(const AudioStreamPacket* const* packets, size_t count) override;
+    size_t GetAudioBatchLimit() const override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
@@ -25,6 +28,8 @@ private:
     EventGroupHandle_t event_group_handle_;
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
+    AudioPacketFramer framer_;
+    bool audio_batch_ = false;  // The server hello accepted batched uplink frames
 
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;
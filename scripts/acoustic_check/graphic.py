@@ -37,6 +37,11 @@ class UDPServerProtocol(asyncio.DatagramProtocol):
         
         # 只处理来自已记录客户端的数据
         if addr == self.client_address:
+            # 新固件的数据报带有 20 字节头部 (见 audio_debugger.h), 只取麦克风 (tap 0) 的数据
+            if len(data) >= 20 and data[0] == 0xAD:
+                if data[2] != 0:
+                    return
+                data = data[20:]
             # 将接收到的音频数据添加到队列
             self.data_queue.extend(data)
         else:
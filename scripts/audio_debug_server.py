@@ -1,54 +1,166 @@
 import socket
+import struct
 import wave
 import argparse
+import time
+from array import array
 
 
 '''
-  Create a UDP socket and bind it to the server's IP:8000.
-  Listen for incoming messages and print them to the console.
-  Save the audio to a WAV file.
+  Receive the audio debugger taps over UDP (CONFIG_USE_AUDIO_DEBUGGER) and save them as WAV files.
+
+  Each datagram is a 20 byte little-endian header (magic 0xAD, version, tap, reserved, sample rate,
+  sequence, timestamp in us) followed by 16-bit mono PCM. Taps with the same sample rate are written
+  as the channels of one WAV, all placed on the device clock so they line up sample for sample;
+  dropped datagrams become silence and are reported per tap.
+
+  Datagrams without the header (older firmware) are saved as raw PCM, as before.
 '''
-def main(samplerate, channels):
+
+HEADER = struct.Struct('<BBBBIIq')
+MAGIC = 0xAD
+TAP_NAMES = ['mic', 'reference', 'processed', 'decoded', 'playback']
+
+
+class Tap:
+    def __init__(self, tap_id, sample_rate):
+        self.tap_id = tap_id
+        self.name = TAP_NAMES[tap_id] if tap_id < len(TAP_NAMES) else f'tap{tap_id}'
+        self.sample_rate = sample_rate
+        self.blocks = []            # (sequence, timestamp_us, pcm)
+        self.next_sequence = None
+        self.datagrams = 0
+        self.dropped = 0
+        self.reordered = 0
+
+    def add(self, sequence, timestamp_us, pcm):
+        if self.next_sequence is not None:
+            if sequence > self.next_sequence:
+                self.dropped += sequence - self.next_sequence
+            elif sequence < self.next_sequence:
+                self.reordered += 1
+        if self.next_sequence is None or sequence >= self.next_sequence:
+            self.next_sequence = sequence + 1
+        self.datagrams += 1
+        self.blocks.append((sequence, timestamp_us, pcm))
+
+    def render(self, start_us):
+        '''Samples from start_us on; contiguous datagrams join exactly, gaps are placed by timestamp'''
+        samples = array('h')
+        previous = None
+        for sequence, timestamp_us, pcm in sorted(self.blocks, key=lambda block: block[0]):
+            if previous is not None and sequence == previous + 1:
+                position = len(samples)
+            else:
+                position = max(0, round((timestamp_us - start_us) * self.sample_rate / 1000000))
+            if position > len(samples):
+                samples.extend(array('h', [0]) * (position - len(samples)))
+            del samples[position:]
+            samples.extend(pcm)
+            previous = sequence
+        return samples
+
+
+def save(taps, prefix):
+    if not taps:
+        print('No tagged audio received')
+        return
+    start_us = min(min(block[1] for block in tap.blocks) for tap in taps.values())
+    rates = sorted({tap.sample_rate for tap in taps.values()})
+    for rate in rates:
+        group = [taps[tap_id] for tap_id in sorted(taps) if taps[tap_id].sample_rate == rate]
+        tracks = [tap.render(start_us) for tap in group]
+        length = max(len(track) for track in tracks)
+        for track in tracks:
+            track.extend(array('h', [0]) * (length - len(track)))
+        frames = array('h', [0]) * (length * len(tracks))
+        for channel, track in enumerate(tracks):
+            frames[channel::len(tracks)] = track
+
+        filename = f'{prefix}_{rate}.wav'
+        with wave.open(filename, 'wb') as wav_file:
+            wav_file.setnchannels(len(tracks))
+            wav_file.setsampwidth(2)
+            wav_file.setframerate(rate)
+            wav_file.writeframes(frames.tobytes())
+        channels = ', '.join(f'{channel}: {tap.name}' for channel, tap in enumerate(group))
+        print(f"Saved '{filename}' ({length / rate:.2f} s, channels {channels})")
+
+    for tap_id in sorted(taps):
+        tap = taps[tap_id]
+        first_us = min(block[1] for block in tap.blocks)
+        total = tap.datagrams + tap.dropped
+        print(f'{tap.name:>10}: {tap.datagrams} datagrams, {tap.dropped} dropped ({100.0 * tap.dropped / total:.2f}%), '
+              f'{tap.reordered} out of order, starts at +{(first_us - start_us) / 1000:.1f} ms')
+
+
+def main(port, prefix, samplerate, channels, duration):
     # Create a UDP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    server_socket.bind(('0.0.0.0', 8000))
+    server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+    server_socket.bind(('0.0.0.0', port))
+    server_socket.settimeout(0.5)
 
-    # Create WAV file with parameters
-    filename = f"{samplerate}_{channels}.wav"
-    wav_file = wave.open(filename, "wb")
-    wav_file.setnchannels(channels)     # channels parameter
-    wav_file.setsampwidth(2)            # 2 bytes per sample (16-bit)
-    wav_file.setframerate(samplerate)   # samplerate parameter
-
-    print(f"Start saving audio from 0.0.0.0:8000 to {filename}...")
+    taps = {}
+    raw_file = None
+    print(f"Start saving audio from 0.0.0.0:{port} to {prefix}_*.wav...")
 
+    started = time.monotonic()
+    last_report = started
     try:
-        while True:
-            # Receive a message from the client
-            message, address = server_socket.recvfrom(8000)
-            
-            # Write PCM data to WAV file
-            wav_file.writeframes(message)
-
-            # Print length of the message
-            print(f"Received {len(message)} bytes from {address}")
-    
+        while duration <= 0 or time.monotonic() - started < duration:
+            try:
+                message, address = server_socket.recvfrom(2048)
+            except socket.timeout:
+                continue
+
+            if len(message) >= HEADER.size and message[0] == MAGIC:
+                _, _, tap_id, _, rate, sequence, timestamp_us = HEADER.unpack_from(message)
+                tap = taps.get(tap_id)
+                if tap is None:
+                    tap = taps[tap_id] = Tap(tap_id, rate)
+                    print(f'Receiving {tap.name} at {rate} Hz from {address}')
+                pcm = array('h')
+                pcm.frombytes(message[HEADER.size:len(message) // 2 * 2])
+                tap.add(sequence, timestamp_us, pcm)
+            else:
+                # Untagged PCM from older firmware
+                if raw_file is None:
+                    raw_file = wave.open(f'{prefix}_raw_{samplerate}_{channels}.wav', 'wb')
+                    raw_file.setnchannels(channels)
+                    raw_file.setsampwidth(2)
+                    raw_file.setframerate(samplerate)
+                raw_file.writeframes(message)
+
+            now = time.monotonic()
+            if now - last_report >= 5:
+                last_report = now
+                print(', '.join(f'{tap.name} {tap.datagrams} (-{tap.dropped})' for tap in taps.values()))
+
     except KeyboardInterrupt:
         print("\nStopping recording...")
-    
+
     finally:
         # Close files and socket
-        wav_file.close()
         server_socket.close()
-        print(f"WAV file '{filename}' saved successfully")
+        if raw_file is not None:
+            raw_file.close()
+            print(f"Raw WAV file '{prefix}_raw_{samplerate}_{channels}.wav' saved")
+        save(taps, prefix)
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='UDP音频数据接收器，保存为WAV文件')
-    parser.add_argument('--samplerate', '-s', type=int, default=16000, 
-                        help='采样率 (默认: 16000)')
-    parser.add_argument('--channels', '-c', type=int, default=2, 
-                        help='声道数 (默认: 2)')
-    
+    parser = argparse.ArgumentParser(description='UDP音频调试数据接收器，按采样率保存对齐的多声道WAV文件')
+    parser.add_argument('--port', '-p', type=int, default=8000,
+                        help='UDP端口 (默认: 8000)')
+    parser.add_argument('--output', '-o', default='capture',
+                        help='输出文件名前缀 (默认: capture)')
+    parser.add_argument('--duration', '-d', type=float, default=0,
+                        help='录制秒数, 0 表示直到 Ctrl+C (默认: 0)')
+    parser.add_argument('--samplerate', '-s', type=int, default=16000,
+                        help='无头部旧固件数据的采样率 (默认: 16000)')
+    parser.add_argument('--channels', '-c', type=int, default=2,
+                        help='无头部旧固件数据的声道数 (默认: 2)')
+
     args = parser.parse_args()
-    main(args.samplerate, args.channels)
+    main(args.port, args.output, args.samplerate, args.channels, args.duration)
@@ -0,0 +1,129 @@
+#ifndef AFSK_REFERENCE_H
+#define AFSK_REFERENCE_H
+
+#include "afsk_demod.h"
+
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+#include <vector>
+
+/*
+ * Shared by afsk_test and afsk_benchmark: an AFSK transmitter at the 16 kHz input rate, and the
+ * demodulator as it was before the Goertzel bank (float decimation and one deque-based Goertzel
+ * filter per tone), as the baseline.
+ */
+
+#define AFSK_INPUT_RATE 16000
+
+// Continuous phase AFSK of `bits` after `offset` samples of silence, with white noise at `snr_db`
+// relative to the tone power
+static std::vector<int16_t> afsk_synthesize(const std::vector<uint8_t>& bits, size_t offset, double snr_db,
+    double amplitude, std::mt19937& rng) {
+    size_t samples_per_bit = AFSK_INPUT_RATE / kBitRate;
+    std::vector<int16_t> pcm(offset + bits.size() * samples_per_bit + samples_per_bit);
+    double noise_rms = amplitude / std::sqrt(2.0) / std::pow(10.0, snr_db / 20.0);
+    std::normal_distribution<double> noise(0.0, noise_rms);
+    double phase = 0;
+    for (size_t i = 0; i < pcm.size(); i++) {
+        double value = noise(rng);
+        if (i >= offset && i - offset < bits.size() * samples_per_bit) {
+            double frequency = bits[(i - offset) / samples_per_bit] ? kMarkFrequency : kSpaceFrequency;
+            phase += 2 * M_PI * frequency / AFSK_INPUT_RATE;
+            value += amplitude * std::sin(phase);
+        }
+        pcm[i] = (int16_t)std::max(-32767.0, std::min(32767.0, std::round(value)));
+    }
+    return pcm;
+}
+
+// Bits of a byte string, most significant bit first
+static void afsk_append_bytes(std::vector<uint8_t>& bits, const std::string& bytes) {
+    for (unsigned char byte : bytes) {
+        for (int i = 7; i >= 0; i--) {
+            bits.push_back((byte >> i) & 1);
+        }
+    }
+}
+
+class LegacyAfskDemodulator {
+public:
+    LegacyAfskDemodulator() : mark_(kMarkFrequency), space_(kSpaceFrequency) {}
+
+    std::vector<float> Process(const std::vector<int16_t>& audio_data) {
+        // Downsample the audio data
+        const float step = (float)AFSK_INPUT_RATE / (float)kAudioSampleRate;
+        std::vector<float> downsampled_data;
+        size_t last_index = 0;
+        downsampled_data.reserve(audio_data.size() / (size_t)step);
+        for (size_t i = 0; i < audio_data.size(); ++i) {
+            size_t sample_index = (size_t)(i / step);
+            if ((sample_index + 1) > last_index) {
+                downsampled_data.push_back((float)audio_data[i]);
+                last_index = sample_index + 1;
+            }
+        }
+
+        std::vector<float> result;
+        for (float sample : downsampled_data) {
+            if (input_buffer_.size() < kWindowSize) {
+                input_buffer_.push_back(sample);
+                continue;
+            }
+            input_buffer_.pop_front();
+            input_buffer_.push_back(sample);
+            if (++output_sample_count_ >= kAudioSampleRate / kBitRate) {
+                for (float window_sample : input_buffer_) {
+                    mark_.ProcessSample(window_sample);
+                    space_.ProcessSample(window_sample);
+                }
+                float mark = mark_.GetAmplitude();
+                float space = space_.GetAmplitude();
+                result.push_back(mark / (space + mark + std::numeric_limits<float>::epsilon()));
+                mark_.Reset();
+                space_.Reset();
+                output_sample_count_ = 0;
+            }
+        }
+        return result;
+    }
+
+private:
+    class Detector {
+    public:
+        explicit Detector(size_t frequency) {
+            float w = 2.0f * M_PI * frequency / kAudioSampleRate;
+            cos_ = std::cos(w);
+            sin_ = std::sin(w);
+            Reset();
+        }
+        void Reset() {
+            state_.clear();
+            state_.push_back(0.0f);
+            state_.push_back(0.0f);
+        }
+        void ProcessSample(float sample) {
+            float s2 = state_.front();
+            state_.pop_front();
+            float s1 = state_.front();
+            state_.pop_front();
+            state_.push_back(s1);
+            state_.push_back(sample + 2.0f * cos_ * s1 - s2);
+        }
+        float GetAmplitude() const {
+            float real = cos_ * state_[1] - state_[0];
+            float imaginary = sin_ * state_[1];
+            return std::sqrt(real * real + imaginary * imaginary) / (kWindowSize / 2.0f);
+        }
+    private:
+        float cos_, sin_;
+        std::deque<float> state_;
+    };
+
+    Detector mark_, space_;
+    std::deque<float> input_buffer_;
+    size_t output_sample_count_ = 0;
+};
+
+#endif // AFSK_REFERENCE_H
@@ -0,0 +1,87 @@
+#include "afsk_demod.h"
+#include "afsk_reference.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Demodulates synthesized AFSK with white noise and a few bit timing offsets, and checks the bit error
+ * rate of the Goertzel bank against the demodulator it replaced; then sends a full credentials frame
+ * through AudioDataBuffer. Exits with status 1 if either falls short.
+ */
+
+#define TEST_BITS 4000
+#define TEST_AMPLITUDE 6000.0
+#define TEST_READ_SAMPLES 480
+
+// Reads like ReceiveWifiCredentialsFromAudio does, 30 ms at a time
+static std::vector<float> demodulate(const std::vector<int16_t>& pcm) {
+    audio_wifi_config::AudioSignalProcessor processor(AFSK_INPUT_RATE, kAudioSampleRate, kMarkFrequency,
+        kSpaceFrequency, kBitRate, kWindowSize);
+    std::vector<float> probabilities(processor.GetMaxProbabilities(TEST_READ_SAMPLES));
+    std::vector<float> result;
+    for (size_t offset = 0; offset < pcm.size(); offset += TEST_READ_SAMPLES) {
+        size_t count = std::min<size_t>(TEST_READ_SAMPLES, pcm.size() - offset);
+        count = processor.ProcessAudioSamples(pcm.data() + offset, count, probabilities.data(), probabilities.size());
+        result.insert(result.end(), probabilities.begin(), probabilities.begin() + count);
+    }
+    return result;
+}
+
+// Window k of the new demodulator ends with bit k, the legacy one skipped its first window
+static double bit_error_rate(const std::vector<float>& probabilities, const std::vector<uint8_t>& bits, size_t skip) {
+    size_t compared = 0, errors = 0;
+    for (size_t i = skip; i < bits.size() && i - skip < probabilities.size(); i++) {
+        compared++;
+        errors += (probabilities[i - skip] > 0.5f) != (bits[i] != 0);
+    }
+    return compared ? (double)errors / compared : 1.0;
+}
+
+int main() {
+    std::mt19937 rng(7);
+    std::bernoulli_distribution coin(0.5);
+    std::vector<uint8_t> bits(TEST_BITS);
+    for (auto& bit : bits) {
+        bit = coin(rng);
+    }
+
+    bool ok = true;
+    printf("%8s %8s %12s %12s\n", "snr dB", "offset", "goertzel", "legacy");
+    for (double snr_db : {20.0, 10.0, 3.0, 0.0, -6.0}) {
+        for (size_t offset : {0, 16, 40}) {
+            auto pcm = afsk_synthesize(bits, offset, snr_db, TEST_AMPLITUDE, rng);
+            double ber = bit_error_rate(demodulate(pcm), bits, 0);
+            LegacyAfskDemodulator legacy;
+            double legacy_ber = bit_error_rate(legacy.Process(pcm), bits, 1);
+            // The bank may not do worse than the float Goertzel it replaced, and has to be clean at 10 dB and up
+            bool pass = ber <= legacy_ber + 0.002 && (snr_db < 10.0 || ber == 0.0);
+            ok = ok && pass;
+            printf("%8.0f %7.0f%% %12.5f %12.5f  %s\n", snr_db, 100.0 * offset / (AFSK_INPUT_RATE / kBitRate), ber,
+                legacy_ber, pass ? "ok" : "FAIL");
+        }
+    }
+
+    // SSID and password with the checksum byte, framed by the default identifiers after a preamble
+    std::string text = "xiaozhi-test\npassword-1234";
+    std::vector<uint8_t> frame;
+    afsk_append_bytes(frame, std::string(4, '\xAA'));
+    frame.insert(frame.end(), audio_wifi_config::kDefaultStartTransmissionPattern.begin(),
+        audio_wifi_config::kDefaultStartTransmissionPattern.end());
+    afsk_append_bytes(frame, text);
+    afsk_append_bytes(frame, std::string(1, (char)audio_wifi_config::AudioDataBuffer::CalculateChecksum(text)));
+    frame.insert(frame.end(), audio_wifi_config::kDefaultEndTransmissionPattern.begin(),
+        audio_wifi_config::kDefaultEndTransmissionPattern.end());
+
+    auto pcm = afsk_synthesize(frame, 40, 10.0, TEST_AMPLITUDE, rng);
+    auto probabilities = demodulate(pcm);
+    audio_wifi_config::AudioDataBuffer buffer;
+    bool decoded = buffer.ProcessProbabilityData(probabilities.data(), probabilities.size()) &&
+        buffer.decoded_text == text;
+    ok = ok && decoded;
+    printf("credentials frame at 10 dB: %s\n", decoded ? "decoded" : "FAILED");
+
+    return ok ? 0 : 1;
+}
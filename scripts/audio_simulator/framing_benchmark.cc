@@ -0,0 +1,167 @@
+#include "audio_packet_framer.h"
+#include "audio_frame_pool.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Websocket audio framing as it was (a std::string per outgoing frame, a fresh packet and payload vector
+ * per incoming one) against AudioPacketFramer with pooled packets, over a minute of 60 ms frames each
+ * way. Reports the bytes written into intermediate buffers and the heap allocations per second of audio.
+ */
+
+#define BENCHMARK_SECONDS 60
+#define FRAME_DURATION_MS 60
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+struct Result {
+    size_t bytes_copied = 0;
+    size_t allocations = 0;
+    double ns = 0;
+};
+
+static volatile size_t sink = 0;
+
+// The frame the transport would mask and send
+static void send(const void* data, size_t size) {
+    sink = sink + ((const uint8_t*)data)[size - 1];
+}
+
+static Result legacy(int version, const std::vector<AudioStreamPacket>& packets,
+    const std::vector<std::vector<uint8_t>>& frames) {
+    Result result;
+    size_t start_allocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& packet : packets) {
+        if (version == 2) {
+            std::string serialized;
+            serialized.resize(sizeof(BinaryProtocol2) + packet.payload.size());
+            auto bp2 = (BinaryProtocol2*)serialized.data();
+            bp2->version = htons(version);
+            bp2->type = 0;
+            bp2->reserved = 0;
+            bp2->timestamp = htonl(packet.timestamp);
+            bp2->payload_size = htonl(packet.payload.size());
+            memcpy(bp2->payload, packet.payload.data(), packet.payload.size());
+            send(serialized.data(), serialized.size());
+            // Zero filled by resize, then the header and the payload
+            result.bytes_copied += 2 * serialized.size();
+        } else if (version == 3) {
+            std::string serialized;
+            serialized.resize(sizeof(BinaryProtocol3) + packet.payload.size());
+            auto bp3 = (BinaryProtocol3*)serialized.data();
+            bp3->type = 0;
+            bp3->reserved = 0;
+            bp3->payload_size = htons(packet.payload.size());
+            memcpy(bp3->payload, packet.payload.data(), packet.payload.size());
+            send(serialized.data(), serialized.size());
+            result.bytes_copied += 2 * serialized.size();
+        } else {
+            send(packet.payload.data(), packet.payload.size());
+        }
+    }
+
+    for (auto& frame : frames) {
+        auto payload = frame.data() + AudioPacketFramer::HeaderSize(version);
+        size_t payload_size = frame.size() - AudioPacketFramer::HeaderSize(version);
+        uint32_t timestamp = version == 2 ? ntohl(((const BinaryProtocol2*)frame.data())->timestamp) : 0;
+        auto incoming = std::make_unique<AudioStreamPacket>(AudioStreamPacket{
+            .sample_rate = 24000,
+            .frame_duration = FRAME_DURATION_MS,
+            .timestamp = timestamp,
+            .payload = std::vector<uint8_t>(payload, payload + payload_size)
+        });
+        result.bytes_copied += incoming->payload.size();
+        sink = sink + incoming->payload.back();
+    }
+    result.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = allocations - start_allocations;
+    return result;
+}
+
+static Result framer(int version, const std::vector<AudioStreamPacket>& packets,
+    const std::vector<std::vector<uint8_t>>& frames) {
+    AudioFramePool pool;
+    pool.Initialize(0, 8, 0, FRAME_DURATION_MS * 64000 / 8 / 1000);
+    AudioPacketFramer framer;
+
+    Result result;
+    size_t start_allocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& packet : packets) {
+        size_t size;
+        auto frame = framer.Serialize(version, packet, size);
+        send(frame, size);
+        if (AudioPacketFramer::HeaderSize(version) > 0) {
+            result.bytes_copied += size;
+        }
+    }
+
+    for (auto& frame : frames) {
+        auto incoming = pool.AcquirePacket();
+        framer.Deserialize(version, frame.data(), frame.size(), *incoming);
+        result.bytes_copied += incoming->payload.size();
+        sink = sink + incoming->payload.back();
+        pool.Release(std::move(incoming));
+    }
+    result.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = allocations - start_allocations;
+    return result;
+}
+
+int main() {
+    // Speech at 16-24 kbps, 60 ms frames
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<size_t> frame_bytes(100, 180);
+    std::vector<AudioStreamPacket> packets(BENCHMARK_SECONDS * 1000 / FRAME_DURATION_MS);
+    for (size_t i = 0; i < packets.size(); i++) {
+        packets[i].timestamp = i * FRAME_DURATION_MS;
+        packets[i].payload.resize(frame_bytes(rng));
+        for (auto& byte : packets[i].payload) {
+            byte = rng();
+        }
+    }
+
+    printf("%-8s %-8s %14s %14s %12s\n", "version", "framing", "bytes/s", "allocs/s", "ns/frame");
+    for (int version : {1, 2, 3}) {
+        // What the server sends, received into a buffer the transport owns
+        AudioPacketFramer server;
+        std::vector<std::vector<uint8_t>> frames;
+        for (auto& packet : packets) {
+            size_t size;
+            auto frame = server.Serialize(version, packet, size);
+            frames.emplace_back(frame, frame + size);
+        }
+        Result before = legacy(version, packets, frames);
+        Result after = framer(version, packets, frames);
+        for (auto& [name, result] : {std::pair<const char*, Result&>{"legacy", before}, {"framer", after}}) {
+            printf("%-8d %-8s %14.0f %14.1f %12.1f\n", version, name, (double)result.bytes_copied / BENCHMARK_SECONDS,
+                (double)result.allocations / BENCHMARK_SECONDS, result.ns / packets.size() / 2);
+        }
+    }
+    return 0;
+}
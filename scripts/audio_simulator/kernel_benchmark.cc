@@ -0,0 +1,157 @@
+#include "audio_kernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+/*
+ * Times the sample format kernels against the per-sample loops they replaced, on one 60 ms frame at
+ * 48 kHz stereo, and checks that both produce the same samples.
+ */
+
+#define FRAMES 2880
+#define ITERATIONS 20000
+
+static double time_ns(const std::function<void()>& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+}
+
+template <typename T>
+static void report(const char* name, double scalar_ns, double kernel_ns, const std::vector<T>& expected, const std::vector<T>& actual,
+    int64_t tolerance = 0) {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        mismatches += std::abs(int64_t(expected[i]) - int64_t(actual[i])) > tolerance;
+    }
+    printf("%-24s scalar %8.0f ns  kernel %8.0f ns  %5.1fx  %s\n", name, scalar_ns, kernel_ns, scalar_ns / kernel_ns,
+        mismatches == 0 ? "ok" : "MISMATCH");
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> sample(INT16_MIN, INT16_MAX);
+    std::vector<int16_t> pcm(FRAMES * 2);
+    std::vector<int32_t> slots(FRAMES * 2);
+    for (auto& value : pcm) {
+        value = sample(rng);
+    }
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i] = pcm[i] * 8191;
+    }
+
+    {
+        int volume = 70;
+        std::vector<int32_t> expected(pcm.size()), actual(pcm.size());
+        double scalar_ns = time_ns([&]() {
+            int32_t volume_factor = pow(double(volume) / 100.0, 2) * 65536;
+            for (size_t i = 0; i < pcm.size(); i++) {
+                int64_t temp = int64_t(pcm[i]) * volume_factor;
+                expected[i] = temp > INT32_MAX ? INT32_MAX : temp < INT32_MIN ? INT32_MIN : static_cast<int32_t>(temp);
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_s16_to_s32(pcm.data(), actual.data(), pcm.size(), audio_volume_gain(volume));
+        });
+        report("s16 -> s32 with volume", scalar_ns, kernel_ns, expected, actual);
+    }
+
+    {
+        std::vector<int16_t> expected(slots.size()), actual(slots.size());
+        double scalar_ns = time_ns([&]() {
+            for (size_t i = 0; i < slots.size(); i++) {
+                int32_t value = slots[i] >> 12;
+                expected[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_s32_to_s16(slots.data(), actual.data(), slots.size(), 12);
+        });
+        report("s32 -> s16", scalar_ns, kernel_ns, expected, actual);
+    }
+
+    {
+        std::vector<int16_t> expected(pcm.size()), actual(pcm.size());
+        double scalar_ns = time_ns([&]() {
+            for (size_t i = 0; i < pcm.size(); i++) {
+                int32_t amplified = pcm[i] * 20;
+                expected[i] = (amplified > 32767) ? 32767 : (amplified < -32768) ? -32768 : amplified;
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_scale_s16(pcm.data(), actual.data(), pcm.size(), 20 * 65536);
+        });
+        report("s16 gain x20", scalar_ns, kernel_ns, expected, actual);
+    }
+
+    {
+        // Speaker volume on the LilyGo codecs, which scaled through float before
+        int volume = 70;
+        std::vector<int16_t> expected(pcm.size()), actual(pcm.size());
+        double scalar_ns = time_ns([&]() {
+            for (size_t i = 0; i < pcm.size(); i++) {
+                expected[i] = (float)pcm[i] * (float)(volume / 100.0);
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_scale_s16(pcm.data(), actual.data(), pcm.size(), volume * 65536 / 100);
+        });
+        // Float truncation and the Q16 shift may round one LSB apart
+        report("s16 volume 70%", scalar_ns, kernel_ns, expected, actual, 1);
+    }
+
+    {
+        std::vector<int16_t> expected(FRAMES), actual(FRAMES);
+        double scalar_ns = time_ns([&]() {
+            for (size_t i = 0, j = 0; i < expected.size(); ++i, j += 2) {
+                expected[i] = pcm[j];
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_extract_channel_s16(pcm.data(), actual.data(), FRAMES, 2, 0);
+        });
+        report("extract left channel", scalar_ns, kernel_ns, expected, actual);
+    }
+
+    {
+        std::vector<int16_t> left(FRAMES), right(FRAMES), expected(pcm.size()), actual(pcm.size());
+        double scalar_ns = time_ns([&]() {
+            for (size_t i = 0, j = 0; i < FRAMES; ++i, j += 2) {
+                left[i] = pcm[j];
+                right[i] = pcm[j + 1];
+            }
+            for (size_t i = 0, j = 0; i < FRAMES; ++i, j += 2) {
+                expected[j] = left[i];
+                expected[j + 1] = right[i];
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_deinterleave_s16(pcm.data(), left.data(), right.data(), FRAMES);
+            audio_interleave_s16(left.data(), right.data(), actual.data(), FRAMES);
+        });
+        report("deinterleave+interleave", scalar_ns, kernel_ns, expected, actual);
+    }
+
+    {
+        std::vector<int16_t> expected(FRAMES), actual(FRAMES);
+        double scalar_ns = time_ns([&]() {
+            for (size_t i = 0; i < FRAMES; i++) {
+                expected[i] = (pcm[2 * i] + pcm[2 * i + 1]) / 2;
+            }
+        });
+        double kernel_ns = time_ns([&]() {
+            audio_downmix_s16(pcm.data(), actual.data(), FRAMES, 2);
+        });
+        report("stereo downmix", scalar_ns, kernel_ns, expected, actual);
+    }
+    return 0;
+}
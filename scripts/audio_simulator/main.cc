@@ -0,0 +1,298 @@
+#include "audio_service.h"
+#include "audio_latency_tracer.h"
+#include "audio_link_monitor.h"
+#include "wav_audio_codec.h"
+#include "board.h"
+
+#include <esp_timer.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Runs the firmware's AudioService on the host: the WAV codec stands in for the microphone and speaker,
+ * and the send queue is looped back into the decode queue the way the server echoes audio in a test
+ * session, optionally with simulated packet loss and network jitter. A second WAV can be played on the
+ * music stream at the same time, the way Esp32Music feeds its decoded MP3 frames, to exercise the mixer.
+ */
+
+struct Options {
+    std::string input_path;
+    std::string output_path;
+    std::string music_path;
+    int output_sample_rate = 24000;
+    bool realtime = false;
+    int loss_percent = 0;
+    int jitter_ms = 0;
+    int frame_duration_ms = OPUS_FRAME_DURATION_MS;
+    unsigned seed = 1;
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options] <input.wav> <output.wav>\n"
+        "  --realtime          Pace the microphone and speaker like the I2S DMA\n"
+        "  --output-rate <hz>  Speaker sample rate (default 24000)\n"
+        "  --loss <percent>    Drop this share of uplink packets before loopback\n"
+        "  --jitter <ms>       Delay each looped back packet by a random 0..ms\n"
+        "  --frame <ms>        Uplink frame duration negotiated for the session: 20, 40 or 60 (default 60)\n"
+        "  --seed <n>          Seed for loss and jitter (default 1)\n"
+        "  --music <wav>       Play this 16-bit WAV on the music stream, ducked under the speech\n", program);
+}
+
+static bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--realtime") {
+            options.realtime = true;
+        } else if (arg == "--output-rate" && has_value) {
+            options.output_sample_rate = atoi(argv[++i]);
+        } else if (arg == "--loss" && has_value) {
+            options.loss_percent = atoi(argv[++i]);
+        } else if (arg == "--jitter" && has_value) {
+            options.jitter_ms = atoi(argv[++i]);
+        } else if (arg == "--frame" && has_value) {
+            options.frame_duration_ms = atoi(argv[++i]);
+        } else if (arg == "--music" && has_value) {
+            options.music_path = argv[++i];
+        } else if (arg == "--seed" && has_value) {
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        } else if (arg[0] == '-') {
+            return false;
+        } else if (options.input_path.empty()) {
+            options.input_path = arg;
+        } else if (options.output_path.empty()) {
+            options.output_path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.input_path.empty() && !options.output_path.empty() && options.output_sample_rate > 0;
+}
+
+static uint32_t read_le(const uint8_t* data, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// Whole 16-bit PCM WAV file into memory
+static bool load_wav(const std::string& path, std::vector<int16_t>& samples, int& sample_rate, int& channels) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open %s\n", path.c_str());
+        return false;
+    }
+    uint8_t header[12];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+        memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0;
+    bool has_format = false;
+    uint8_t chunk[8];
+    while (ok && fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+        uint32_t chunk_size = read_le(chunk + 4, 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16) {
+            uint8_t format[16];
+            ok = fread(format, 1, sizeof(format), file) == sizeof(format) &&
+                read_le(format, 2) == 1 && read_le(format + 14, 2) == 16;
+            channels = read_le(format + 2, 2);
+            sample_rate = read_le(format + 4, 4);
+            has_format = true;
+            fseek(file, chunk_size - sizeof(format) + (chunk_size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0 && has_format) {
+            samples.resize(chunk_size / 2);
+            samples.resize(fread(samples.data(), 2, samples.size(), file));
+            fclose(file);
+            return channels > 0 && sample_rate > 0;
+        } else {
+            fseek(file, chunk_size + (chunk_size & 1), SEEK_CUR);
+        }
+    }
+    fprintf(stderr, "%s is not a 16-bit PCM WAV file\n", path.c_str());
+    fclose(file);
+    return false;
+}
+
+static double average_ms(uint64_t total_us, uint32_t count) {
+    return count > 0 ? total_us / 1000.0 / count : 0;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<int16_t> music;
+    int music_sample_rate = 0;
+    int music_channels = 0;
+    if (!options.music_path.empty() && !load_wav(options.music_path, music, music_sample_rate, music_channels)) {
+        return 2;
+    }
+
+    WavAudioCodec codec(options.input_path, options.output_path, options.output_sample_rate, options.realtime);
+    if (!codec.ok()) {
+        return 2;
+    }
+    Board::GetInstance().SetAudioCodec(&codec);
+
+    std::mutex mutex;
+    std::condition_variable send_queue_cv;
+    AudioService audio_service;
+    audio_service.Initialize(&codec);
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [&mutex, &send_queue_cv]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        send_queue_cv.notify_one();
+    };
+    audio_service.SetCallbacks(callbacks);
+    audio_service.Start();
+    // What the application does once the server hello has settled the frame duration
+    audio_service.SetEncodeFrameDuration(options.frame_duration_ms);
+    audio_service.EnableVoiceProcessing(true);
+
+    // MP3-sized chunks, written as fast as the music queue takes them
+    std::atomic<bool> music_finished{music.empty()};
+    std::thread music_thread([&]() {
+        size_t chunk = 1152 * music_channels;
+        for (size_t offset = 0; offset < music.size(); offset += chunk) {
+            size_t samples = std::min(chunk, music.size() - offset);
+            if (!audio_service.WriteMusicData(music.data() + offset, samples, music_sample_rate, music_channels)) {
+                break;
+            }
+        }
+        music_finished = true;
+    });
+
+    auto& tracer = AudioLatencyTracer::GetInstance();
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> jitter_us(0, options.jitter_ms * 1000);
+    std::multimap<int64_t, std::unique_ptr<AudioStreamPacket>> in_flight;
+    AudioLinkMonitor link_monitor;
+    link_monitor.Reset(options.frame_duration_ms);
+    int64_t link_report_time = esp_timer_get_time();
+    uint32_t sequence = 0;
+    uint32_t sent_count = 0;
+    uint32_t dropped_count = 0;
+    bool input_stopped = false;
+    uint32_t last_playback_count = 0;
+    auto last_activity = std::chrono::steady_clock::now();
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            send_queue_cv.wait_for(lock, std::chrono::milliseconds(5));
+        }
+        auto now = std::chrono::steady_clock::now();
+
+        // Uplink: what Application::SendAudio would hand to the protocol
+        while (auto packet = audio_service.PopPacketFromSendQueue()) {
+            int64_t send_time = esp_timer_get_time();
+            tracer.Record(kLatencyStageSend, packet->stage_time_us, send_time);
+            tracer.Record(kLatencyStageUplink, packet->origin_time_us, send_time);
+            sent_count++;
+            last_activity = now;
+            packet->sequence = ++sequence;
+            packet->has_sequence = true;
+            if (percent(rng) < options.loss_percent) {
+                dropped_count++;
+                audio_service.RecyclePacket(std::move(packet));
+                continue;
+            }
+            int64_t delay_us = options.jitter_ms > 0 ? jitter_us(rng) : 0;
+            in_flight.emplace(send_time + delay_us, std::move(packet));
+        }
+
+        // Downlink: packets whose simulated network delay has passed arrive at OnIncomingAudio
+        int64_t receive_time = esp_timer_get_time();
+        while (!in_flight.empty() && in_flight.begin()->first <= receive_time) {
+            auto packet = std::move(in_flight.begin()->second);
+            in_flight.erase(in_flight.begin());
+            packet->origin_time_us = esp_timer_get_time();
+            if (!link_monitor.OnPacket(packet->sequence, packet->origin_time_us)) {
+                audio_service.RecyclePacket(std::move(packet));
+                continue;
+            }
+            audio_service.PushPacketToDecodeQueue(std::move(packet), true);
+            last_activity = now;
+        }
+        // What Application does on its clock tick
+        if (receive_time - link_report_time >= 1000000) {
+            AudioLinkQuality link;
+            link_monitor.Report(link);
+            audio_service.SetLinkQuality(link);
+            link_report_time = receive_time;
+        }
+
+        if (!input_stopped && codec.input_finished()) {
+            audio_service.EnableVoiceProcessing(false);
+            input_stopped = true;
+            last_activity = now;
+        }
+
+        uint32_t playback_count = audio_service.GetDebugStatistics().playback_count;
+        if (playback_count != last_playback_count) {
+            last_playback_count = playback_count;
+            last_activity = now;
+        }
+        // Done once the input is stopped and nothing has moved for a while (the jitter buffer may hold the tail)
+        if (input_stopped && music_finished && in_flight.empty() && audio_service.IsIdle() &&
+            now - last_activity > std::chrono::milliseconds(500)) {
+            break;
+        }
+    }
+
+    auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(last_activity - start_time).count();
+    audio_service.Stop();
+    music_thread.join();
+    // Let the audio tasks see the stop flag before the codec goes away
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    codec.Close();
+
+    tracer.PrintStats();
+    auto statistics = audio_service.GetDebugStatistics();
+    double input_seconds = (double)codec.input_frames() / codec.input_sample_rate();
+    double output_seconds = (double)codec.output_frames() / codec.output_sample_rate();
+    printf("\n=== Audio simulator ===\n");
+    printf("input: %.2f s, output: %.2f s, wall: %.2f s, speed: %.1fx realtime\n",
+        input_seconds, output_seconds, wall_ms / 1000.0, wall_ms > 0 ? input_seconds * 1000 / wall_ms : 0);
+    printf("frames: input %u, encoded %u, sent %u, dropped %u, decoded %u, played %u\n",
+        statistics.input_count, statistics.encode_count, sent_count, dropped_count,
+        statistics.decode_count, statistics.playback_count);
+    printf("jitter buffer: late %u, lost %u, concealed %u, jitter %u ms, depth %u\n",
+        statistics.late_packet_count, statistics.lost_packet_count, statistics.concealed_frame_count,
+        statistics.jitter_ms, statistics.jitter_depth);
+    AudioLinkQuality link;
+    link_monitor.Report(link);
+    printf("link: received %u, expected %u, lost %u, reordered %u, duplicates %u, jitter %u ms\n",
+        link.received, link.expected, link.lost, link.reordered, link.duplicates, link.jitter_ms);
+    printf("opus: encode avg %.2f ms max %.2f ms, decode avg %.2f ms max %.2f ms\n",
+        average_ms(statistics.encode_time_total_us, statistics.encode_count), statistics.encode_time_max_us / 1000.0,
+        average_ms(statistics.decode_time_total_us, statistics.decode_count), statistics.decode_time_max_us / 1000.0);
+    printf("encoder: complexity %d, dtx %s\n", statistics.encoder_complexity, statistics.encoder_dtx ? "on" : "off");
+    printf("queue high water: encode %u/%d, send %u/%d, decode %u/%d, playback %u/%d\n",
+        statistics.encode_queue_high_water, MAX_ENCODE_TASKS_IN_QUEUE,
+        statistics.send_queue_high_water, 2400 / options.frame_duration_ms,
+        statistics.decode_queue_high_water, MAX_DECODE_PACKETS_IN_QUEUE,
+        statistics.playback_queue_high_water, MAX_PLAYBACK_TASKS_IN_QUEUE);
+    printf("frame pool allocations: %u\n", statistics.pool_alloc_count);
+    printf("latency: %s\n", tracer.GetStatsJson().c_str());
+    fflush(stdout);
+
+    // Fail the run when nothing made it through the loop, so CI catches a broken pipeline
+    return statistics.playback_count > 0 ? 0 : 1;
+}
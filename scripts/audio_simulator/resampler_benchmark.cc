@@ -0,0 +1,163 @@
+#include "audio_resampler.h"
+#include "opus_resampler.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+/*
+ * Compares AudioResampler with OpusResampler on the conversions the firmware does. Quality is the
+ * worst SNR over a set of in-band tones (the residual after fitting a sine of the tone's frequency to
+ * the output), plus the attenuation of a tone just above the output Nyquist rate when downsampling.
+ * Speed is the time per output sample, fed in 60 ms blocks.
+ *
+ * The firmware's OpusResampler wraps the SILK resampler, which the system libopus does not export;
+ * on the host its figures are those of the linear stand-in in shim/opus_wrappers.cc.
+ */
+
+#define BLOCK_MS 60
+#define SECONDS 2
+
+struct Conversion {
+    int input_rate;
+    int output_rate;
+};
+
+static const Conversion kConversions[] = {
+    {24000, 16000}, {16000, 24000}, {24000, 48000}, {48000, 16000}, {44100, 16000}, {44100, 24000},
+};
+
+static std::vector<int16_t> tone(int rate, double frequency, double amplitude) {
+    std::vector<int16_t> pcm(rate * SECONDS);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = std::lround(amplitude * std::sin(2 * M_PI * frequency * i / rate));
+    }
+    return pcm;
+}
+
+// Feeds the input in blocks, returns the output
+static std::vector<int16_t> run(const std::function<size_t(const int16_t*, size_t, int16_t*)>& process,
+        const std::vector<int16_t>& input, int input_rate, size_t max_output) {
+    std::vector<int16_t> output;
+    std::vector<int16_t> block(max_output);
+    size_t block_samples = input_rate * BLOCK_MS / 1000;
+    for (size_t offset = 0; offset + block_samples <= input.size(); offset += block_samples) {
+        size_t produced = process(input.data() + offset, block_samples, block.data());
+        output.insert(output.end(), block.begin(), block.begin() + produced);
+    }
+    return output;
+}
+
+// Power of a sine fitted at the given frequency over the power of the residual, skipping the start
+static double snr_db(const std::vector<int16_t>& pcm, int rate, double frequency) {
+    size_t start = rate / 10;
+    double c = 0, s = 0;
+    for (size_t i = start; i < pcm.size(); i++) {
+        double phase = 2 * M_PI * frequency * i / rate;
+        c += pcm[i] * std::cos(phase);
+        s += pcm[i] * std::sin(phase);
+    }
+    size_t count = pcm.size() - start;
+    c = 2 * c / count;
+    s = 2 * s / count;
+    double signal = 0, noise = 0;
+    for (size_t i = start; i < pcm.size(); i++) {
+        double phase = 2 * M_PI * frequency * i / rate;
+        double fitted = c * std::cos(phase) + s * std::sin(phase);
+        signal += fitted * fitted;
+        noise += (pcm[i] - fitted) * (pcm[i] - fitted);
+    }
+    return 10 * std::log10(signal / std::max(noise, 1e-9));
+}
+
+static double rms(const std::vector<int16_t>& pcm, size_t start) {
+    double sum = 0;
+    for (size_t i = start; i < pcm.size(); i++) {
+        sum += (double)pcm[i] * pcm[i];
+    }
+    return std::sqrt(sum / std::max<size_t>(1, pcm.size() - start));
+}
+
+struct Result {
+    double snr_db = 1e9;
+    double alias_db = 0;
+    double ns_per_sample = 0;
+    double cycles_per_sample = 0;
+};
+
+static Result measure(const Conversion& conversion,
+        const std::function<void()>& reset,
+        const std::function<size_t(const int16_t*, size_t, int16_t*)>& process, size_t max_output) {
+    Result result;
+    double nyquist = std::min(conversion.input_rate, conversion.output_rate) / 2.0;
+    for (double frequency : {300.0, 1000.0, 3000.0, 0.7 * nyquist}) {
+        reset();
+        auto output = run(process, tone(conversion.input_rate, frequency, 16000), conversion.input_rate, max_output);
+        result.snr_db = std::min(result.snr_db, snr_db(output, conversion.output_rate, frequency));
+    }
+
+    if (conversion.output_rate < conversion.input_rate) {
+        reset();
+        auto input = tone(conversion.input_rate, conversion.output_rate / 2.0 * 1.1, 16000);
+        auto output = run(process, input, conversion.input_rate, max_output);
+        result.alias_db = 20 * std::log10(std::max(rms(output, conversion.output_rate / 10), 1e-3) / rms(input, 0));
+    }
+
+    auto input = tone(conversion.input_rate, 1000, 16000);
+    reset();
+    size_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+#if HAVE_TSC
+    uint64_t cycles = __rdtsc();
+#endif
+    for (int i = 0; i < 20; i++) {
+        samples += run(process, input, conversion.input_rate, max_output).size();
+    }
+#if HAVE_TSC
+    result.cycles_per_sample = double(__rdtsc() - cycles) / samples;
+#endif
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    result.ns_per_sample = std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+    return result;
+}
+
+static void report(const char* name, const Conversion& conversion, const Result& result) {
+    char alias[16] = "     -";
+    if (conversion.output_rate < conversion.input_rate) {
+        snprintf(alias, sizeof(alias), "%6.1f", result.alias_db);
+    }
+    printf("%5d -> %5d  %-16s SNR %5.1f dB  alias %s dB  %6.1f ns/sample  %6.1f cycles/sample\n",
+        conversion.input_rate, conversion.output_rate, name, result.snr_db, alias,
+        result.ns_per_sample, result.cycles_per_sample);
+}
+
+int main() {
+    for (auto& conversion : kConversions) {
+        size_t max_output = (size_t)conversion.output_rate * BLOCK_MS / 1000 + 2;
+
+        OpusResampler opus;
+        auto opus_result = measure(conversion,
+            [&]() { opus.Configure(conversion.input_rate, conversion.output_rate); },
+            [&](const int16_t* in, size_t samples, int16_t* out) {
+                opus.Process(in, samples, out);
+                return (size_t)opus.GetOutputSamples(samples);
+            }, max_output);
+        report("OpusResampler", conversion, opus_result);
+
+        AudioResampler polyphase;
+        auto polyphase_result = measure(conversion,
+            [&]() { polyphase.Configure(conversion.input_rate, conversion.output_rate); },
+            [&](const int16_t* in, size_t samples, int16_t* out) {
+                return polyphase.Process(in, samples, out);
+            }, max_output);
+        report("AudioResampler", conversion, polyphase_result);
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "audio_ring_queue.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * The AudioService queue handoff as it was (four deques behind one mutex and one condition variable,
+ * notify_all on every push and pop) against AudioRingQueue with a push and a pop bit per queue in one
+ * event group, as AudioService uses them now.
+ *
+ * Two pipelines run at once like on the device: input -> encode queue -> encoder -> send queue -> sender,
+ * and receiver -> decode queue -> decoder -> playback queue -> output, six threads over four queues of
+ * depth 8. Reports throughput, the end-to-end latency through two queues, and how often a thread woke up
+ * to find its queue still not ready.
+ */
+
+#define ITEMS 200000
+#define QUEUE_DEPTH 8
+#define QUEUES 4
+
+struct Item {
+    std::chrono::steady_clock::time_point created;
+};
+
+struct Result {
+    double items_per_second = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+    size_t wakeups = 0;
+    size_t futile_wakeups = 0;
+};
+
+class LegacyQueues {
+public:
+    void Push(int queue, std::unique_ptr<Item>&& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Wait(lock, [&]() { return queues_[queue].size() < QUEUE_DEPTH; });
+        queues_[queue].push_back(std::move(item));
+        cv_.notify_all();
+    }
+
+    std::unique_ptr<Item> Pop(int queue) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Wait(lock, [&]() { return !queues_[queue].empty(); });
+        auto item = std::move(queues_[queue].front());
+        queues_[queue].pop_front();
+        cv_.notify_all();
+        return item;
+    }
+
+    size_t wakeups = 0;
+    size_t futile_wakeups = 0;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Item>> queues_[QUEUES];
+
+    template <typename Predicate>
+    void Wait(std::unique_lock<std::mutex>& lock, Predicate ready) {
+        if (ready()) {
+            return;
+        }
+        while (true) {
+            cv_.wait(lock);
+            wakeups++;
+            if (ready()) {
+                return;
+            }
+            futile_wakeups++;
+        }
+    }
+};
+
+class RingQueues {
+public:
+    RingQueues() {
+        for (auto& queue : queues_) {
+            queue = std::make_unique<AudioRingQueue<Item>>(QUEUE_DEPTH);
+        }
+        event_group_ = xEventGroupCreate();
+    }
+
+    ~RingQueues() {
+        vEventGroupDelete(event_group_);
+    }
+
+    void Push(int queue, std::unique_ptr<Item>&& item) {
+        while (!queues_[queue]->Push(std::move(item))) {
+            Wait(PoppedBit(queue), [&]() { return !queues_[queue]->Full(); });
+        }
+        xEventGroupSetBits(event_group_, PushedBit(queue));
+    }
+
+    std::unique_ptr<Item> Pop(int queue) {
+        std::unique_ptr<Item> item;
+        while (!(item = queues_[queue]->Pop())) {
+            Wait(PushedBit(queue), [&]() { return queues_[queue]->Pending(); });
+        }
+        xEventGroupSetBits(event_group_, PoppedBit(queue));
+        return item;
+    }
+
+    std::atomic<size_t> wakeups{0};
+    std::atomic<size_t> futile_wakeups{0};
+
+private:
+    std::unique_ptr<AudioRingQueue<Item>> queues_[QUEUES];
+    EventGroupHandle_t event_group_;
+
+    static EventBits_t PushedBit(int queue) { return 1 << (2 * queue); }
+    static EventBits_t PoppedBit(int queue) { return 1 << (2 * queue + 1); }
+
+    template <typename Predicate>
+    void Wait(EventBits_t bit, Predicate ready) {
+        xEventGroupWaitBits(event_group_, bit, pdTRUE, pdFALSE, portMAX_DELAY);
+        wakeups++;
+        if (!ready()) {
+            futile_wakeups++;
+        }
+    }
+};
+
+template <typename Queues>
+static Result run() {
+    Queues queues;
+    std::vector<double> latencies[2];
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int pipeline = 0; pipeline < 2; pipeline++) {
+        int first = 2 * pipeline;
+        latencies[pipeline].reserve(ITEMS);
+        threads.emplace_back([&queues, first]() {
+            for (int i = 0; i < ITEMS; i++) {
+                auto item = std::make_unique<Item>();
+                item->created = std::chrono::steady_clock::now();
+                queues.Push(first, std::move(item));
+            }
+        });
+        threads.emplace_back([&queues, first]() {
+            for (int i = 0; i < ITEMS; i++) {
+                queues.Push(first + 1, queues.Pop(first));
+            }
+        });
+        threads.emplace_back([&queues, &latencies, first, pipeline]() {
+            for (int i = 0; i < ITEMS; i++) {
+                auto item = queues.Pop(first + 1);
+                latencies[pipeline].push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - item->created).count());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all(latencies[0]);
+    all.insert(all.end(), latencies[1].begin(), latencies[1].end());
+    std::sort(all.begin(), all.end());
+    Result result;
+    result.items_per_second = 2 * ITEMS / seconds;
+    result.p50_us = all[all.size() / 2];
+    result.p99_us = all[all.size() * 99 / 100];
+    result.max_us = all.back();
+    result.wakeups = queues.wakeups;
+    result.futile_wakeups = queues.futile_wakeups;
+    return result;
+}
+
+int main() {
+    printf("%-8s %12s %10s %10s %10s %10s %10s\n", "queues", "items/s", "p50 us", "p99 us", "max us", "wakeups", "futile");
+    for (auto& [name, result] : {std::pair<const char*, Result>{"mutex", run<LegacyQueues>()}, {"ring", run<RingQueues>()}}) {
+        printf("%-8s %12.0f %10.1f %10.1f %10.1f %10zu %10zu\n", name, result.items_per_second, result.p50_us,
+            result.p99_us, result.max_us, result.wakeups, result.futile_wakeups);
+    }
+    return 0;
+}
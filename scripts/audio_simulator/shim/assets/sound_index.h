@@ -0,0 +1,8 @@
+// Stands in for the table scripts/gen_sound_index.py generates: the simulator embeds no sounds
+#pragma once
+
+#include "audio_sound_cache.h"
+
+static const OggSoundIndex kEmbeddedSounds[] = {
+    {nullptr, 0, 0, 0, nullptr},
+};
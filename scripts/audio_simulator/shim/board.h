@@ -0,0 +1,21 @@
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+class AudioCodec;
+
+// The audio service only asks the board for its codec
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    AudioCodec* GetAudioCodec() { return audio_codec_; }
+    void SetAudioCodec(AudioCodec* codec) { audio_codec_ = codec; }
+
+private:
+    AudioCodec* audio_codec_ = nullptr;
+};
+
+#endif // SIM_BOARD_H
@@ -0,0 +1,7 @@
+#ifndef SIM_CJSON_H
+#define SIM_CJSON_H
+
+// The IDF component exposes <cJSON.h>, the system package installs it under cjson/
+#include <cjson/cJSON.h>
+
+#endif // SIM_CJSON_H
@@ -0,0 +1,29 @@
+#ifndef SIM_DRIVER_I2S_COMMON_H
+#define SIM_DRIVER_I2S_COMMON_H
+
+#include "esp_err.h"
+
+#include <cstddef>
+
+typedef struct i2s_channel_obj_t* i2s_chan_handle_t;
+
+typedef struct {
+    void* data;
+    size_t size;
+} i2s_event_data_t;
+
+typedef bool (*i2s_isr_callback_t)(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+
+typedef struct {
+    i2s_isr_callback_t on_recv;
+    i2s_isr_callback_t on_recv_q_ovf;
+    i2s_isr_callback_t on_sent;
+    i2s_isr_callback_t on_send_q_ovf;
+} i2s_event_callbacks_t;
+
+inline esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t handle, const i2s_event_callbacks_t* callbacks,
+    void* user_data) { return ESP_OK; }
+inline esp_err_t i2s_channel_enable(i2s_chan_handle_t handle) { return ESP_OK; }
+inline esp_err_t i2s_channel_disable(i2s_chan_handle_t handle) { return ESP_OK; }
+
+#endif // SIM_DRIVER_I2S_COMMON_H
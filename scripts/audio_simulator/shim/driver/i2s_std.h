@@ -0,0 +1,6 @@
+#ifndef SIM_DRIVER_I2S_STD_H
+#define SIM_DRIVER_I2S_STD_H
+
+#include "driver/i2s_common.h"
+
+#endif // SIM_DRIVER_I2S_STD_H
@@ -0,0 +1,23 @@
+#ifndef SIM_ESP_LOG_H
+#define SIM_ESP_LOG_H
+
+#include <cstdio>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Same line format as the IDF console; debug and verbose logs are compiled out unless SIM_LOG_DEBUG is set */
+#define SIM_LOG(letter, tag, format, ...) \
+    fprintf(stderr, letter " (%lu) %s: " format "\n", (unsigned long)xTaskGetTickCount(), tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) SIM_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) SIM_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) SIM_LOG("I", tag, format, ##__VA_ARGS__)
+#ifdef SIM_LOG_DEBUG
+#define ESP_LOGD(tag, format, ...) SIM_LOG("D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) SIM_LOG("V", tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGD(tag, format, ...) do {} while (0)
+#define ESP_LOGV(tag, format, ...) do {} while (0)
+#endif
+
+#endif // SIM_ESP_LOG_H
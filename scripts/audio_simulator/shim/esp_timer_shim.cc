@@ -0,0 +1,107 @@
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::string name;
+    int64_t period_us = 0;
+    int64_t alarm_us = 0;
+    bool armed = false;
+};
+
+// Never destroyed, the detached timer thread still waits on them when the process exits
+static std::mutex& timers_mutex = *new std::mutex();
+static std::condition_variable& timers_cv = *new std::condition_variable();
+static std::vector<esp_timer*>& timers = *new std::vector<esp_timer*>();
+static std::once_flag timer_task_started;
+
+static void timer_task() {
+    std::unique_lock<std::mutex> lock(timers_mutex);
+    while (true) {
+        esp_timer* next = nullptr;
+        for (auto timer : timers) {
+            if (timer->armed && (next == nullptr || timer->alarm_us < next->alarm_us)) {
+                next = timer;
+            }
+        }
+        if (next == nullptr) {
+            timers_cv.wait(lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (next->alarm_us > now) {
+            timers_cv.wait_for(lock, std::chrono::microseconds(next->alarm_us - now));
+            continue;
+        }
+        if (next->period_us > 0) {
+            next->alarm_us = std::max(next->alarm_us + next->period_us, now);
+        } else {
+            next->armed = false;
+        }
+        // The callback may start or stop timers, including its own
+        lock.unlock();
+        next->callback(next->arg);
+        lock.lock();
+    }
+}
+
+static esp_err_t arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    std::call_once(timer_task_started, []() {
+        std::thread(timer_task).detach();
+    });
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period_us;
+    timer->alarm_us = esp_timer_get_time() + timeout_us;
+    timer->armed = true;
+    timers_cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    auto timer = new esp_timer{args->callback, args->arg, args->name ? args->name : ""};
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    timers_cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    timers.erase(std::remove(timers.begin(), timers.end(), timer), timers.end());
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    static const auto boot_time = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot_time).count();
+}
@@ -0,0 +1,19 @@
+#ifndef SIM_MODEL_PATH_H
+#define SIM_MODEL_PATH_H
+
+/* esp-sr is not available on the host: no models are ever found, so wake word detection stays off */
+
+#define ESP_MN_PREFIX "mn"
+#define ESP_WN_PREFIX "wn"
+
+typedef struct {
+    char** model_name;
+    char** model_info;
+    int num;
+} srmodel_list_t;
+
+srmodel_list_t* esp_srmodel_init(const char* partition_label);
+void esp_srmodel_deinit(srmodel_list_t* models);
+char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2);
+
+#endif // SIM_MODEL_PATH_H
@@ -0,0 +1,31 @@
+#ifndef SIM_OPUS_DECODER_H
+#define SIM_OPUS_DECODER_H
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+struct OpusDecoder;
+
+// Same interface as the esp-opus-encoder component, implemented over the system libopus
+class OpusDecoderWrapper {
+public:
+    OpusDecoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusDecoderWrapper();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+    // An empty packet runs packet loss concealment for one frame
+    bool Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm);
+    void ResetState();
+
+private:
+    std::mutex mutex_;
+    OpusDecoder* audio_dec_ = nullptr;
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+};
+
+#endif // SIM_OPUS_DECODER_H
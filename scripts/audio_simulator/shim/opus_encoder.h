@@ -0,0 +1,38 @@
+#ifndef SIM_OPUS_ENCODER_H
+#define SIM_OPUS_ENCODER_H
+
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#define MAX_OPUS_PACKET_SIZE 1000
+
+struct OpusEncoder;
+
+// Same interface as the esp-opus-encoder component, implemented over the system libopus
+class OpusEncoderWrapper {
+public:
+    OpusEncoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusEncoderWrapper();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+    void SetDtx(bool enable);
+    void SetComplexity(int complexity);
+    void Encode(std::vector<int16_t>&& pcm, std::function<void(std::vector<uint8_t>&& opus)> handler);
+    bool Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus);
+    bool IsBufferEmpty() const { return in_buffer_.empty(); }
+    void ResetState();
+
+private:
+    std::mutex mutex_;
+    OpusEncoder* audio_enc_ = nullptr;
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+    std::vector<int16_t> in_buffer_;
+};
+
+#endif // SIM_OPUS_ENCODER_H
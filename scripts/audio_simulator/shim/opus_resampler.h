@@ -0,0 +1,26 @@
+#ifndef SIM_OPUS_RESAMPLER_H
+#define SIM_OPUS_RESAMPLER_H
+
+#include <cstdint>
+
+/*
+ * The component wraps libopus's internal SILK resampler, which the system library does not export.
+ * This stand-in keeps the interface and does linear interpolation, carrying the last sample across
+ * calls; good enough for pipeline timing, not for judging audio quality.
+ */
+class OpusResampler {
+public:
+    void Configure(int input_sample_rate, int output_sample_rate);
+    void Process(const int16_t* input, int input_samples, int16_t* output);
+    int GetOutputSamples(int input_samples) const;
+
+    inline int input_sample_rate() const { return input_sample_rate_; }
+    inline int output_sample_rate() const { return output_sample_rate_; }
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int16_t last_sample_ = 0;
+};
+
+#endif // SIM_OPUS_RESAMPLER_H
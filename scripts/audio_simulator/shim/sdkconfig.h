@@ -0,0 +1,11 @@
+#ifndef SIM_SDKCONFIG_H
+#define SIM_SDKCONFIG_H
+
+/*
+ * Host build configuration: no AFE audio processor, no S3/P4 wake word engines, no heap hooks and no
+ * audio debugger, so the audio service runs NoAudioProcessor and counts frame pool allocations.
+ */
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_SOC_CPU_CORES_NUM 2
+
+#endif // SIM_SDKCONFIG_H
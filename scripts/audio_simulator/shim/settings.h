@@ -0,0 +1,38 @@
+#ifndef SIM_SETTINGS_H
+#define SIM_SETTINGS_H
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+// In-memory stand-in for the NVS backed settings, nothing is persisted
+class Settings {
+public:
+    Settings(const std::string& ns, bool read_write = false) : ns_(ns) {}
+
+    std::string GetString(const std::string& key, const std::string& default_value = "") {
+        auto it = Strings().find(ns_ + "." + key);
+        return it != Strings().end() ? it->second : default_value;
+    }
+    void SetString(const std::string& key, const std::string& value) { Strings()[ns_ + "." + key] = value; }
+
+    int32_t GetInt(const std::string& key, int32_t default_value = 0) {
+        auto it = Ints().find(ns_ + "." + key);
+        return it != Ints().end() ? it->second : default_value;
+    }
+    void SetInt(const std::string& key, int32_t value) { Ints()[ns_ + "." + key] = value; }
+
+private:
+    std::string ns_;
+
+    static std::map<std::string, std::string>& Strings() {
+        static std::map<std::string, std::string> values;
+        return values;
+    }
+    static std::map<std::string, int32_t>& Ints() {
+        static std::map<std::string, int32_t> values;
+        return values;
+    }
+};
+
+#endif // SIM_SETTINGS_H
@@ -0,0 +1,179 @@
+#include "wav_audio_codec.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#define TAG "WavAudioCodec"
+
+static uint32_t read_le32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint16_t read_le16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static void write_le32(uint8_t* data, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        data[i] = value >> (8 * i);
+    }
+}
+
+static void write_le16(uint8_t* data, uint16_t value) {
+    data[0] = value;
+    data[1] = value >> 8;
+}
+
+WavAudioCodec::WavAudioCodec(const std::string& input_path, const std::string& output_path, int output_sample_rate, bool realtime)
+    : realtime_(realtime) {
+    duplex_ = true;
+    input_reference_ = false;
+    output_sample_rate_ = output_sample_rate;
+    output_channels_ = 1;
+    if (OpenInput(input_path)) {
+        OpenOutput(output_path);
+    }
+}
+
+WavAudioCodec::~WavAudioCodec() {
+    Close();
+    if (input_file_ != nullptr) {
+        fclose(input_file_);
+    }
+}
+
+bool WavAudioCodec::OpenInput(const std::string& path) {
+    input_file_ = fopen(path.c_str(), "rb");
+    if (input_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+        return false;
+    }
+
+    uint8_t header[12];
+    if (fread(header, 1, sizeof(header), input_file_) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+        fclose(input_file_);
+        input_file_ = nullptr;
+        return false;
+    }
+
+    // Walk the chunks up to "data", picking up the format on the way
+    bool has_format = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), input_file_) == sizeof(chunk)) {
+        uint32_t chunk_size = read_le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16) {
+            uint8_t format[16];
+            if (fread(format, 1, sizeof(format), input_file_) != sizeof(format)) {
+                break;
+            }
+            uint16_t audio_format = read_le16(format);
+            uint16_t bits_per_sample = read_le16(format + 14);
+            if (audio_format != 1 || bits_per_sample != 16) {
+                ESP_LOGE(TAG, "%s must be 16-bit PCM (format %u, %u bits)", path.c_str(), audio_format, bits_per_sample);
+                break;
+            }
+            input_channels_ = read_le16(format + 2);
+            input_sample_rate_ = read_le32(format + 4);
+            has_format = input_channels_ == 1 || input_channels_ == 2;
+            fseek(input_file_, chunk_size - sizeof(format) + (chunk_size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!has_format) {
+                break;
+            }
+            input_data_remaining_ = chunk_size;
+            ESP_LOGI(TAG, "Input %s: %d Hz, %d channel(s), %.1f s", path.c_str(), input_sample_rate_, input_channels_,
+                (double)chunk_size / 2 / input_channels_ / input_sample_rate_);
+            return true;
+        } else {
+            fseek(input_file_, chunk_size + (chunk_size & 1), SEEK_CUR);
+        }
+    }
+
+    ESP_LOGE(TAG, "%s has no usable fmt/data chunks", path.c_str());
+    fclose(input_file_);
+    input_file_ = nullptr;
+    return false;
+}
+
+bool WavAudioCodec::OpenOutput(const std::string& path) {
+    output_file_ = fopen(path.c_str(), "wb");
+    if (output_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create %s", path.c_str());
+        return false;
+    }
+    // Sizes are filled in by Close()
+    uint8_t header[44] = {};
+    fwrite(header, 1, sizeof(header), output_file_);
+    return true;
+}
+
+void WavAudioCodec::Close() {
+    if (output_file_ == nullptr) {
+        return;
+    }
+    uint32_t data_size = output_samples_written_ * sizeof(int16_t);
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    write_le32(header + 4, 36 + data_size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    write_le32(header + 16, 16);
+    write_le16(header + 20, 1);
+    write_le16(header + 22, output_channels_);
+    write_le32(header + 24, output_sample_rate_);
+    write_le32(header + 28, output_sample_rate_ * output_channels_ * sizeof(int16_t));
+    write_le16(header + 32, output_channels_ * sizeof(int16_t));
+    write_le16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    write_le32(header + 40, data_size);
+    fseek(output_file_, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), output_file_);
+    fclose(output_file_);
+    output_file_ = nullptr;
+}
+
+void WavAudioCodec::Pace(std::chrono::steady_clock::time_point& next_time, int samples, int sample_rate, int channels) {
+    auto now = std::chrono::steady_clock::now();
+    // Start over after an idle period instead of bursting to catch up
+    if (next_time < now - std::chrono::milliseconds(100)) {
+        next_time = now;
+    }
+    next_time += std::chrono::microseconds((int64_t)samples * 1000000 / channels / sample_rate);
+    std::this_thread::sleep_until(next_time);
+}
+
+int WavAudioCodec::Read(int16_t* dest, int samples) {
+    size_t read = 0;
+    if (input_data_remaining_ > 0) {
+        size_t wanted = std::min<size_t>(samples, input_data_remaining_ / sizeof(int16_t));
+        read = fread(dest, sizeof(int16_t), wanted, input_file_);
+        input_data_remaining_ = read == wanted ? input_data_remaining_ - read * sizeof(int16_t) : 0;
+        input_samples_read_ += read;
+    }
+    if (read < (size_t)samples) {
+        memset(dest + read, 0, (samples - read) * sizeof(int16_t));
+        if (!input_finished_) {
+            ESP_LOGI(TAG, "Input finished after %llu frames", (unsigned long long)input_frames());
+            input_finished_ = true;
+        }
+    }
+    // Silence after the end of the input is always paced, so it does not flood the pipeline
+    if (realtime_ || input_finished_) {
+        Pace(next_read_time_, samples, input_sample_rate_, input_channels_);
+    }
+    return samples;
+}
+
+int WavAudioCodec::Write(const int16_t* data, int samples) {
+    if (output_file_ != nullptr) {
+        fwrite(data, sizeof(int16_t), samples, output_file_);
+        output_samples_written_ += samples;
+    }
+    if (realtime_) {
+        Pace(next_write_time_, samples, output_sample_rate_, output_channels_);
+    }
+    return samples;
+}
@@ -0,0 +1,49 @@
+#ifndef WAV_AUDIO_CODEC_H
+#define WAV_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+/*
+ * AudioCodec backed by WAV files: the microphone reads 16-bit PCM from the input file and the speaker
+ * appends to the output file. Once the input is exhausted the microphone keeps delivering silence,
+ * since a failed read makes the audio input task stop. With `realtime` both directions are paced
+ * like the I2S DMA would; otherwise they run as fast as the pipeline allows.
+ */
+class WavAudioCodec : public AudioCodec {
+public:
+    WavAudioCodec(const std::string& input_path, const std::string& output_path, int output_sample_rate, bool realtime);
+    virtual ~WavAudioCodec();
+
+    // Patches the output header with the final sizes, called by the destructor if needed
+    void Close();
+
+    inline bool ok() const { return input_file_ != nullptr && output_file_ != nullptr; }
+    inline bool input_finished() const { return input_finished_; }
+    inline uint64_t input_frames() const { return input_samples_read_ / input_channels_; }
+    inline uint64_t output_frames() const { return output_samples_written_ / output_channels_; }
+
+private:
+    FILE* input_file_ = nullptr;
+    FILE* output_file_ = nullptr;
+    bool realtime_;
+    uint32_t input_data_remaining_ = 0;
+    std::atomic<bool> input_finished_{false};
+    std::atomic<uint64_t> input_samples_read_{0};
+    std::atomic<uint64_t> output_samples_written_{0};
+    std::chrono::steady_clock::time_point next_read_time_;
+    std::chrono::steady_clock::time_point next_write_time_;
+
+    bool OpenInput(const std::string& path);
+    bool OpenOutput(const std::string& path);
+    void Pace(std::chrono::steady_clock::time_point& next_time, int samples, int sample_rate, int channels);
+
+    virtual int Read(int16_t* dest, int samples) override;
+    virtual int Write(const int16_t* data, int samples) override;
+};
+
+#endif // WAV_AUDIO_CODEC_H
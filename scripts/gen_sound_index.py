@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+Generate the Opus packet table of the OGG sounds embedded in the firmware.
+
+AudioService::PlaySound looks the sound up in this table and queues its packets straight from
+flash, instead of scanning the OGG pages on every call. The parsing mirrors the runtime parser in
+AudioService::PlaySound, so both produce the same packets.
+"""
+import argparse
+import os
+
+HEADER_TEMPLATE = """// Auto-generated by scripts/gen_sound_index.py, do not edit
+#pragma once
+
+#include "audio_sound_cache.h"
+
+{sounds}
+
+static const OggSoundIndex kEmbeddedSounds[] = {{
+{entries}
+    {{nullptr, 0, 0, 0, nullptr}},
+}};
+"""
+
+
+def parse_ogg(data):
+    """Return (sample_rate, [(offset, size)]) of the audio packets, skipping OpusHead and OpusTags"""
+    packets = []
+    sample_rate = 16000
+    seen_head = False
+    seen_tags = False
+    offset = 0
+    size = len(data)
+    while True:
+        pos = data.find(b'OggS', offset)
+        if pos < 0 or pos + 27 > size:
+            break
+        page_segments = data[pos + 26]
+        seg_table_off = pos + 27
+        if seg_table_off + page_segments > size:
+            break
+        lacing = data[seg_table_off:seg_table_off + page_segments]
+        body_off = seg_table_off + page_segments
+        body_size = sum(lacing)
+        if body_off + body_size > size:
+            break
+
+        cur = body_off
+        seg_idx = 0
+        while seg_idx < page_segments:
+            pkt_start = cur
+            pkt_len = 0
+            while True:
+                length = lacing[seg_idx]
+                seg_idx += 1
+                pkt_len += length
+                cur += length
+                if length != 255 or seg_idx >= page_segments:
+                    break
+            if pkt_len == 0:
+                continue
+            packet = data[pkt_start:pkt_start + pkt_len]
+            if not seen_head:
+                if pkt_len >= 19 and packet[:8] == b'OpusHead':
+                    seen_head = True
+                    sample_rate = int.from_bytes(packet[12:16], 'little')
+                continue
+            if not seen_tags:
+                if pkt_len >= 8 and packet[:8] == b'OpusTags':
+                    seen_tags = True
+                continue
+            packets.append((pkt_start, pkt_len))
+
+        offset = body_off + body_size
+    return sample_rate, packets
+
+
+def touch(path):
+    with open(path, 'a'):
+        pass
+    os.utime(path, None)
+
+
+def generate_header(sound_files, output_path, stamp_path=None):
+    sounds = []
+    entries = []
+    for path in sorted(sound_files, key=os.path.basename):
+        base_name = os.path.splitext(os.path.basename(path))[0]
+        with open(path, 'rb') as f:
+            data = f.read()
+        sample_rate, packets = parse_ogg(data)
+        if not packets:
+            print(f"Warning: no Opus packets found in {path}")
+            continue
+        refs = ",\n".join(f"    {{{offset}, {length}}}" for offset, length in packets)
+        sounds.append(f'''extern const char sound_{base_name}_start[] asm("_binary_{base_name}_ogg_start");
+static const OggPacketRef sound_{base_name}_packets[] = {{
+{refs},
+}};''')
+        entries.append(f"    {{sound_{base_name}_start, {len(data)}, {sample_rate}, {len(packets)}, sound_{base_name}_packets}},")
+        print(f"  - {base_name}: {len(packets)} packets, {sample_rate} Hz")
+
+    content = HEADER_TEMPLATE.format(sounds="\n\n".join(sounds), entries="\n".join(entries))
+    os.makedirs(os.path.dirname(output_path), exist_ok=True)
+    # Keep the old file when nothing changed, so the audio sources are not rebuilt. The build tracks
+    # the stamp instead, which is always touched, so the command does not rerun on every build.
+    unchanged = False
+    if os.path.exists(output_path):
+        with open(output_path, 'r', encoding='utf-8') as f:
+            unchanged = f.read() == content
+    if not unchanged:
+        with open(output_path, 'w', encoding='utf-8') as f:
+            f.write(content)
+    if stamp_path:
+        touch(stamp_path)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Generate the packet index of the embedded OGG sounds")
+    parser.add_argument("--output", required=True, help="Output header file path")
+    parser.add_argument("--stamp", help="Stamp file touched on every run")
+    parser.add_argument("sounds", nargs="*", help="Embedded OGG files")
+    args = parser.parse_args()
+
+    try:
+        generate_header(args.sounds, args.output, args.stamp)
+        print(f"Successfully generated sound index: {args.output}")
+    except Exception as e:
+        print(f"Error: {e}")
+        exit(1)